@@ -0,0 +1,432 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// count every allocation made by the library & stb_truetype (which allocates through RL_MALLOC)
+static atomic_ullong allocationCount = 0;
+static atomic_ullong allocationBytes = 0;
+
+static void *BenchMalloc(size_t size)
+{
+    atomic_fetch_add_explicit(&allocationCount, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocationBytes, size, memory_order_relaxed);
+    return malloc(size);
+}
+
+static void *BenchCalloc(size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&allocationCount, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocationBytes, count * size, memory_order_relaxed);
+    return calloc(count, size);
+}
+
+static void *BenchRealloc(void *ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&allocationCount, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocationBytes, size, memory_order_relaxed);
+    return realloc(ptr, size);
+}
+
+#define RL_MALLOC(sz)       BenchMalloc(sz)
+#define RL_CALLOC(n,sz)     BenchCalloc(n,sz)
+#define RL_REALLOC(ptr,sz)  BenchRealloc(ptr,sz)
+#define RL_FREE(ptr)        free(ptr)
+
+#define RLTEXTKERNER_NO_RAYLIB
+#define RLTEXTKERNER_IMPLEMENTATION
+#include "rltextkerner.h"
+
+// benchmark of the text kerning functions without a window, on the fonts bundled in the font folder
+//
+// usage: ./bench [--json] [--quick] [--check] [--threads N] [--accumulate]
+//
+// For each font, text corpus, font size & subpixel setting this reports the time per glyph for the first render (cold,
+// rasterizing glyphs into the cache) and for renders once the cache is warm, along with the allocations per render.
+// --json prints one JSON object per result instead of a table, for tracking results between versions. --check fails
+// if a warm render allocates anything besides the images it returns (one per text) - batches are only checked with one
+// thread, as threads started for a batch allocate their own scratch memory.
+//
+// The raster rows time rasterizing every glyph of each font with stb_truetype's rasterizer (rast-stb) & the
+// accumulation rasterizer (rast-acc), as glyph cache misses do - --check also fails if their bitmaps differ by more than
+// RASTER_TOLERANCE. --accumulate renders the text with the accumulation rasterizer.
+//
+// Build with make bench BENCHFLAGS=-DRLTEXTKERNER_STATS to also print where the time of the warm renders goes, from the
+// font stats (the timers slow kerning down, so compare ns/glyph from builds without them).
+
+typedef struct BenchCorpus {
+    const char *name;
+    const char **texts;
+    int textCount;
+    int maxWidth;
+    int maxHeight;
+    int wrap;
+} BenchCorpus;
+
+typedef struct BenchResult {
+    const char *font;
+    const char *corpus;
+    const char *phase;
+    int fontSize;
+    int subpixel;
+    int calls;
+    long long glyphs;
+    double seconds;
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+} BenchResult;
+
+static const char *labelTexts[] = {
+    "OK", "Cancel", "Apply", "Options", "New Game", "Load Game", "Save Game", "Quit", "Volume", "Fullscreen",
+    "AVATAR", "Inventory", "Health: 100/100", "Mana: 42/50", "Level 7", "Gold: 1,024", "Quest Log", "Map", "Skills",
+    "Press any key to continue", "Are you sure?", "Yes", "No", "Back", "Next", "Previous", "Settings", "Credits",
+    "Wave 3 of 10", "Score: 123456", "High Score", "Paused", "Resume", "Restart", "Difficulty: Hard", "WAVE", "To",
+};
+
+static const char *loremTexts[] = {
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Mauris semper tellus ante, in consectetur lacus pretium in. Sed vel semper leo. Ut non nunc vitae tellus sollicitudin elementum. Nunc tempus consectetur urna, sit amet consectetur justo fermentum at. Cras pulvinar pretium felis, a efficitur leo condimentum id. Vivamus ex risus, tristique sed pretium eu, mollis ut nisl. Donec tincidunt sed tortor ac sollicitudin. Morbi consectetur posuere ligula non pretium.\n\n"
+    "Donec dignissim urna eget nisl gravida mattis. Suspendisse mattis ornare porttitor. Nam varius blandit sapien vel porta. Fusce in elit volutpat, placerat erat ut, tempus lectus. In iaculis nisi at imperdiet varius. Integer dapibus egestas lobortis. Vivamus vel ultricies ante. Nunc dictum quis neque nec consequat. Morbi sed orci a dui rutrum ultrices. Integer porttitor massa ut nisl imperdiet elementum. Aliquam quis ex in nibh pellentesque commodo at in neque.",
+    "A C looks kinda weird, because the C has this curve that can usually fit quite snugly into the slope of the A like so: AC. Same thing goes for VA or WA; there's this nice parallel between the W and the A that would otherwise be an unsightly void.",
+};
+
+static const char *longLineTexts[] = {
+    "testingareallyreallyreallylonglinetestingareallyreallyreallylonglinetestingareallyreallyreallylonglinetestingareallyreallyreallylonglinetestingareallyreallyreallylonglinetestingareallyreallyreallylongline",
+    "The quick brown fox jumps over the lazy dog. THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG. 0123456789 !@#$%^&*()[]{}",
+};
+
+static const char *unicodeTexts[] = {
+    "日本語のテキストを表示する 中文文本 한국어 텍스트",
+    "☥ ★ ☆ ♠ ♣ ♥ ♦ → ← ↑ ↓ ∑ ∞ ≈ ≠ ≤ ≥ © ® ™ € £ ¥ § ¶ † ‡ • … ‰",
+    "Ελληνικά κείμενα και Кириллица текст",
+};
+
+#define COUNT_OF(array) ((int) (sizeof(array) / sizeof((array)[0])))
+
+static BenchCorpus corpora[] = {
+    { "labels", labelTexts, COUNT_OF(labelTexts), 1024, 256, 0 },
+    { "lorem", loremTexts, COUNT_OF(loremTexts), 1200, 2048, 1 },
+    { "long-line", longLineTexts, COUNT_OF(longLineTexts), 16384, 256, 0 },
+    { "unicode", unicodeTexts, COUNT_OF(unicodeTexts), 2048, 256, 0 },
+};
+
+static const char *fontFiles[] = { "font/NotoSans-Light.ttf", "font/DejaVuSans.ttf" };
+static const int fontSizes[] = { 12, 24, 48 };
+
+#define RASTER_TOLERANCE 16 // most the two rasterizers may differ in any pixel
+
+static double GetSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// peak resident memory of the process in kilobytes
+static long GetPeakMemory(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// glyphs drawn for a corpus (codepoints other than whitespace)
+static long long CountGlyphs(const BenchCorpus *corpus)
+{
+    long long glyphs = 0;
+    for (int i = 0; i < corpus->textCount; i++) {
+        int count = 0;
+        int *codepoints = LoadCodepoints(corpus->texts[i], &count);
+        for (int j = 0; j < count; j++) {
+            if (codepoints[j] != ' ' && codepoints[j] != '\t' && codepoints[j] != '\n') ++glyphs;
+        }
+        UnloadCodepoints(codepoints);
+    }
+
+    return glyphs;
+}
+
+static void RenderCorpus(const BenchCorpus *corpus, FontWithKerning font, int fontSize, int subpixel)
+{
+    for (int i = 0; i < corpus->textCount; i++) {
+        Image image = KernTextEx(corpus->texts[i], font, fontSize, corpus->maxWidth, corpus->maxHeight, corpus->wrap, subpixel);
+        UnloadImage(image);
+    }
+}
+
+static void RenderCorpusBatch(const BenchCorpus *corpus, FontWithKerning font, int fontSize, int subpixel, int threadCount, Image *images)
+{
+    KernTextBatch(corpus->texts, corpus->textCount, font, fontSize, corpus->maxWidth, corpus->maxHeight, corpus->wrap, subpixel, threadCount, images);
+    for (int i = 0; i < corpus->textCount; i++) UnloadImage(images[i]);
+}
+
+static void PrintResult(BenchResult result, int json)
+{
+    double nsPerGlyph = result.glyphs > 0 ? result.seconds * 1e9 / result.glyphs : 0;
+    double glyphsPerSecond = result.seconds > 0 ? result.glyphs / result.seconds : 0;
+    double allocationsPerCall = result.calls > 0 ? (double) result.allocations / result.calls : 0;
+    double bytesPerCall = result.calls > 0 ? (double) result.allocatedBytes / result.calls : 0;
+
+    if (json) {
+        printf("{\"font\":\"%s\",\"corpus\":\"%s\",\"phase\":\"%s\",\"size\":%d,\"subpixel\":%d,\"calls\":%d,\"glyphs\":%lld,"
+               "\"seconds\":%.9f,\"ns_per_glyph\":%.2f,\"glyphs_per_second\":%.0f,\"allocs_per_call\":%.2f,\"bytes_per_call\":%.0f,"
+               "\"peak_rss_kb\":%ld}\n",
+               result.font, result.corpus, result.phase, result.fontSize, result.subpixel, result.calls, result.glyphs,
+               result.seconds, nsPerGlyph, glyphsPerSecond, allocationsPerCall, bytesPerCall, GetPeakMemory());
+    } else {
+        printf("%-22s %-10s %-8s %4d %3d %10.1f %12.0f %10.1f %12.0f %10ld\n",
+               result.font, result.corpus, result.phase, result.fontSize, result.subpixel, nsPerGlyph, glyphsPerSecond,
+               allocationsPerCall, bytesPerCall, GetPeakMemory());
+    }
+}
+
+#if defined(RLTEXTKERNER_STATS)
+// print the font stats as nanoseconds per glyph for each phase of kerning
+static void PrintStats(BenchResult result, FontWithKerningStats stats, int json)
+{
+    double glyphs = stats.glyphLookups > 0 ? (double) stats.glyphLookups : 1;
+
+    if (json) {
+        printf("{\"font\":\"%s\",\"corpus\":\"%s\",\"phase\":\"%s\",\"size\":%d,\"subpixel\":%d,\"stats\":{"
+               "\"strings\":%llu,\"glyph_lookups\":%llu,\"cache_hits\":%llu,\"cache_misses\":%llu,\"rasterizations\":%llu,"
+               "\"kerning_queries\":%llu,\"bytes_allocated\":%llu,\"pixels_composited\":%llu,\"total_ns\":%llu,\"lookup_ns\":%llu,"
+               "\"kerning_ns\":%llu,\"bounding_box_ns\":%llu,\"raster_ns\":%llu,\"composite_ns\":%llu}}\n",
+               result.font, result.corpus, result.phase, result.fontSize, result.subpixel, stats.strings, stats.glyphLookups,
+               stats.cacheHits, stats.cacheMisses, stats.rasterizations, stats.kerningQueries, stats.bytesAllocated,
+               stats.pixelsComposited, stats.totalTime, stats.lookupTime, stats.kerningTime, stats.boundingBoxTime,
+               stats.rasterTime, stats.compositeTime);
+    } else {
+        printf("    ns/glyph: lookup %.1f, kerning %.1f, bounding box %.1f, raster %.1f, composite %.1f, total %.1f"
+               " - %llu cache hits, %llu misses\n",
+               stats.lookupTime / glyphs, stats.kerningTime / glyphs, stats.boundingBoxTime / glyphs, stats.rasterTime / glyphs,
+               stats.compositeTime / glyphs, stats.totalTime / glyphs, stats.cacheHits, stats.cacheMisses);
+    }
+}
+#endif
+
+// run render at least minCalls times & until minSeconds have passed, returning the measurements
+static BenchResult Measure(void (*render)(void *), void *arg, long long glyphsPerCall, double minSeconds, int minCalls)
+{
+    BenchResult result = { 0 };
+    unsigned long long allocations = atomic_load(&allocationCount);
+    unsigned long long allocatedBytes = atomic_load(&allocationBytes);
+    double start = GetSeconds();
+    do {
+        render(arg);
+        ++result.calls;
+        result.seconds = GetSeconds() - start;
+    } while (result.seconds < minSeconds || result.calls < minCalls);
+    result.glyphs = glyphsPerCall * result.calls;
+    result.allocations = atomic_load(&allocationCount) - allocations;
+    result.allocatedBytes = atomic_load(&allocationBytes) - allocatedBytes;
+
+    return result;
+}
+
+typedef struct BenchRun {
+    const BenchCorpus *corpus;
+    FontWithKerning font;
+    int fontSize;
+    int subpixel;
+    int threadCount;
+    Image *images;
+} BenchRun;
+
+static void RenderRun(void *arg)
+{
+    BenchRun *run = arg;
+    RenderCorpus(run->corpus, run->font, run->fontSize, run->subpixel);
+}
+
+static void RenderRunBatch(void *arg)
+{
+    BenchRun *run = arg;
+    RenderCorpusBatch(run->corpus, run->font, run->fontSize, run->subpixel, run->threadCount, run->images);
+}
+
+typedef struct RasterRun {
+    FontFaceWithKerning *face;
+    float scale;
+    unsigned char *bitmaps; // bitmaps of all the glyphs, one after the other
+} RasterRun;
+
+// rasterize every glyph of the font with the current rasterizer, as glyph cache misses do
+static void RasterizeGlyphs(void *arg)
+{
+    RasterRun *run = arg;
+    unsigned char *bitmap = run->bitmaps;
+    for (int glyph = 0; glyph < run->face->info.numGlyphs; glyph++) {
+        const GlyphOutlineWithKerning *outline = GetGlyphOutlineWithKerning(run->face, glyph);
+        if (outline == NULL) continue;
+        int x0, y0, x1, y1;
+        GetGlyphOutlineBoxWithKerning(outline, run->scale, 0, &x0, &y0, &x1, &y1);
+        if (x1 <= x0 || y1 <= y0) continue;
+        BeginKernArenaWithKerning();
+        RasterizeGlyphOutlineWithKerning(outline, bitmap, x1 - x0, y1 - y0, run->scale, 0, x0, y0);
+        EndKernArenaWithKerning();
+        bitmap += (x1 - x0) * (y1 - y0);
+    }
+}
+
+// time both rasterizers on every glyph of the font at a size, returning the largest difference between their pixels
+static int MeasureRasterizers(FontWithKerning font, const char *fontName, int fontSize, double minSeconds, int json, int rasterizer)
+{
+    RasterRun run = { font.cache->face, stbtt_ScaleForPixelHeight(font.info, fontSize), NULL };
+    size_t size = 0;
+    for (int glyph = 0; glyph < run.face->info.numGlyphs; glyph++) {
+        const GlyphOutlineWithKerning *outline = GetGlyphOutlineWithKerning(run.face, glyph);
+        int x0, y0, x1, y1;
+        if (outline != NULL) GetGlyphOutlineBoxWithKerning(outline, run.scale, 0, &x0, &y0, &x1, &y1);
+        if (outline != NULL && x1 > x0 && y1 > y0) size += (x1 - x0) * (y1 - y0);
+    }
+    unsigned char *bitmaps[2] = { calloc(size, 1), calloc(size, 1) };
+    const char *phases[2] = { "rast-stb", "rast-acc" };
+    for (int i = 0; i < 2; i++) {
+        SetKernRasterizer(i == 0 ? KERN_RASTERIZER_STB : KERN_RASTERIZER_ACCUMULATE);
+        run.bitmaps = bitmaps[i];
+        RasterizeGlyphs(&run); // grow the scratch memory first
+        BenchResult result = Measure(RasterizeGlyphs, &run, run.face->info.numGlyphs, minSeconds, 1);
+        result.font = fontName;
+        result.corpus = "glyphs";
+        result.phase = phases[i];
+        result.fontSize = fontSize;
+        PrintResult(result, json);
+    }
+    SetKernRasterizer(rasterizer);
+
+    int difference = 0;
+    for (size_t i = 0; i < size; i++) {
+        int pixel = abs(bitmaps[0][i] - bitmaps[1][i]);
+        if (pixel > difference) difference = pixel;
+    }
+    free(bitmaps[0]);
+    free(bitmaps[1]);
+
+    return difference;
+}
+
+int main(int argc, char **argv)
+{
+    int json = 0;
+    int check = 0;
+    int failures = 0;
+    int threadCount = 1;
+    int rasterizer = KERN_RASTERIZER_STB;
+    double minSeconds = 0.25;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) json = 1;
+        else if (strcmp(argv[i], "--quick") == 0) minSeconds = 0.02;
+        else if (strcmp(argv[i], "--check") == 0) check = 1;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threadCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--accumulate") == 0) rasterizer = KERN_RASTERIZER_ACCUMULATE;
+        else {
+            fprintf(stderr, "usage: %s [--json] [--quick] [--check] [--threads N] [--accumulate]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    SetTraceLogLevel(LOG_ERROR);
+    SetFontWithKerningThreadCount(threadCount);
+    SetKernRasterizer(rasterizer);
+
+    if (!json) {
+        printf("%-22s %-10s %-8s %4s %3s %10s %12s %10s %12s %10s\n",
+               "font", "corpus", "phase", "size", "sub", "ns/glyph", "glyphs/s", "allocs", "bytes", "peak KB");
+    }
+
+    for (int f = 0; f < COUNT_OF(fontFiles); f++) {
+        const char *fontName = strrchr(fontFiles[f], '/') + 1;
+
+        // font load & pre-rendering the other sizes
+        double start = GetSeconds();
+        unsigned long long allocations = atomic_load(&allocationCount);
+        unsigned long long allocatedBytes = atomic_load(&allocationBytes);
+        FontWithKerning font = LoadFontWithKerning(fontFiles[f], fontSizes[0]);
+        if (!font.info) {
+            fprintf(stderr, "unable to load %s - run the benchmark from the example folder\n", fontFiles[f]);
+            return 1;
+        }
+        BenchResult load = { fontName, "-", "load", fontSizes[0], 0, 1, font.glyphCount, GetSeconds() - start,
+                             atomic_load(&allocationCount) - allocations, atomic_load(&allocationBytes) - allocatedBytes };
+        PrintResult(load, json);
+        FontWithKerningMemoryUsage loadUsage = GetFontWithKerningMemoryUsage(font);
+        if (check && (loadUsage.sizeCount != 1 || loadUsage.sizes[0].fontSize != fontSizes[0] || loadUsage.sizes[0].lastUse == 0)) {
+            fprintf(stderr, "%s: after loading, the font sizes aren't just the base size %d\n", fontName, fontSizes[0]);
+            ++failures;
+        }
+
+        start = GetSeconds();
+        allocations = atomic_load(&allocationCount);
+        allocatedBytes = atomic_load(&allocationBytes);
+        UpdateFontWithKerningBitmapsEx(&font, fontSizes + 1, COUNT_OF(fontSizes) - 1, threadCount);
+        BenchResult prewarm = { fontName, "-", "prewarm", fontSizes[1], 0, 1, (long long) font.glyphCount * (COUNT_OF(fontSizes) - 1),
+                                GetSeconds() - start, atomic_load(&allocationCount) - allocations, atomic_load(&allocationBytes) - allocatedBytes };
+        PrintResult(prewarm, json);
+
+        // loading only what the labels use, at all the sizes
+        start = GetSeconds();
+        allocations = atomic_load(&allocationCount);
+        allocatedBytes = atomic_load(&allocationBytes);
+        FontWithKerning corpusFont = LoadFontWithKerningFromCorpus(fontFiles[f], labelTexts, COUNT_OF(labelTexts), fontSizes, COUNT_OF(fontSizes));
+        BenchResult corpusLoad = { fontName, "labels", "corpus", fontSizes[0], 0, 1, (long long) corpusFont.glyphCount * COUNT_OF(fontSizes),
+                                   GetSeconds() - start, atomic_load(&allocationCount) - allocations, atomic_load(&allocationBytes) - allocatedBytes };
+        PrintResult(corpusLoad, json);
+        UnloadFontWithKerning(corpusFont);
+
+        for (int s = 0; s < COUNT_OF(fontSizes); s++) {
+            int difference = MeasureRasterizers(font, fontName, fontSizes[s], minSeconds, json, rasterizer);
+            if (check && difference > RASTER_TOLERANCE) {
+                fprintf(stderr, "%s %d: rasterizers differ by %d in a pixel\n", fontName, fontSizes[s], difference);
+                ++failures;
+            }
+        }
+        UnloadFontWithKerning(font);
+
+        for (int c = 0; c < COUNT_OF(corpora); c++) {
+            const BenchCorpus *corpus = &corpora[c];
+            long long glyphs = CountGlyphs(corpus);
+            Image *images = malloc(corpus->textCount * sizeof(*images));
+
+            for (int s = 0; s < COUNT_OF(fontSizes); s++) {
+                for (int subpixel = 0; subpixel <= 1; subpixel++) {
+                    // load the font for each run, so the first render starts with an empty glyph cache
+                    FontWithKerning font = LoadFontWithKerning(fontFiles[f], fontSizes[0]);
+                    BenchRun run = { corpus, font, fontSizes[s], subpixel, threadCount, images };
+
+                    BenchResult cold = Measure(RenderRun, &run, glyphs, 0, 1);
+                    ResetFontWithKerningStats(font);
+                    BenchResult warm = Measure(RenderRun, &run, glyphs, minSeconds, 3);
+                    FontWithKerningStats warmStats = GetFontWithKerningStats(font);
+                    BenchResult batch = Measure(RenderRunBatch, &run, glyphs, minSeconds, 3);
+                    cold.font = warm.font = batch.font = fontName;
+                    cold.corpus = warm.corpus = batch.corpus = corpus->name;
+                    cold.phase = "cold";
+                    warm.phase = "warm";
+                    batch.phase = "batch";
+                    cold.fontSize = warm.fontSize = batch.fontSize = fontSizes[s];
+                    cold.subpixel = warm.subpixel = batch.subpixel = subpixel;
+                    PrintResult(cold, json);
+                    PrintResult(warm, json);
+#if defined(RLTEXTKERNER_STATS)
+                    PrintStats(warm, warmStats, json);
+#else
+                    (void) warmStats;
+#endif
+                    PrintResult(batch, json);
+                    // batches on several threads start new threads, which allocate their own scratch memory
+                    if (check && (warm.allocations > (unsigned long long) warm.calls * corpus->textCount ||
+                                  (threadCount <= 1 && batch.allocations > (unsigned long long) batch.calls * corpus->textCount))) {
+                        fprintf(stderr, "%s %s %d: warm renders allocate more than their images\n", fontName, corpus->name, fontSizes[s]);
+                        ++failures;
+                    }
+
+                    UnloadFontWithKerning(font);
+                }
+            }
+            free(images);
+        }
+    }
+
+    return failures > 0 ? 1 : 0;
+}
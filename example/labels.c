@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include "raylib.h"
+
+#define RLTEXTKERNER_IMPLEMENTATION
+#include "rltextkerner.h"
+
+// example packing many kerned labels into one atlas texture, so they are all drawn from a single texture
+int main()
+{
+    InitWindow(1920, 1080, "raylib test with font kerning");
+    SetTraceLogLevel(LOG_DEBUG);
+
+    FontWithKerning labelFont = LoadFontWithKerning("font/NotoSans-Light.ttf", 20);
+    if (!labelFont.info) return 1;
+
+    char labelText[300][32];
+    const char *texts[300];
+    int labels[300];
+    for (int i = 0; i < 300; i++) {
+        snprintf(labelText[i], sizeof(labelText[i]), "Label %i: AVATAR", i);
+        texts[i] = labelText[i];
+    }
+
+    LabelAtlasWithKerning atlas = LoadLabelAtlasWithKerning(1024, 1024);
+    AddLabelAtlasTexts(&atlas, texts, 300, labelFont, 20, 1024, 0, labels);
+    Texture2D atlasTexture = LoadTextureFromImage(atlas.image);
+    atlas.modified = 0;
+
+    SetTargetFPS(60);
+
+    int frame = 0;
+    while (!WindowShouldClose()) {
+        // every second, replace a label - the new label reuses the space of the removed one
+        if (++frame % 60 == 0) {
+            int i = (frame / 60) % 300;
+            snprintf(labelText[i], sizeof(labelText[i]), "Label %i: updated %i", i, frame / 60);
+            RemoveLabelAtlasLabel(&atlas, labels[i]);
+            labels[i] = AddLabelAtlasText(&atlas, texts[i], labelFont, 20, 1024, 0);
+        }
+        if (atlas.modified) {
+            UpdateTexture(atlasTexture, atlas.image.data);
+            atlas.modified = 0;
+        }
+
+        BeginDrawing();
+            ClearBackground(BLACK);
+
+            for (int i = 0; i < 300; i++) {
+                if (labels[i] < 0) continue;
+                Vector2 position = { (float) (i % 8) * 240, (float) (i / 8) * 28 };
+                DrawTextureRec(atlasTexture, atlas.labels[labels[i]], position, WHITE);
+            }
+        EndDrawing();
+    }
+
+    UnloadTexture(atlasTexture);
+    UnloadLabelAtlasWithKerning(atlas);
+    UnloadFontWithKerning(labelFont);
+    CloseWindow();
+
+    return 0;
+}
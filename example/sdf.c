@@ -0,0 +1,47 @@
+#include <math.h>
+#include "raylib.h"
+
+#define RLTEXTKERNER_IMPLEMENTATION
+#include "rltextkerner.h"
+
+// example drawing text from a signed distance field atlas, on the GPU at a changing size & on the CPU with KernText
+int main()
+{
+    InitWindow(1920, 1080, "raylib test with SDF font kerning");
+
+    FontWithKerning font = LoadFontWithKerning("font/NotoSans-Light.ttf", 32);
+    if (!font.info) return 1;
+    UpdateFontWithKerningSdf(&font, 48);
+    Texture2D atlas = LoadTextureFromImage(GetFontWithKerningSdfAtlas(font));
+    SetTextureFilter(atlas, TEXTURE_FILTER_BILINEAR);
+    Shader shader = LoadSdfShaderWithKerning();
+
+    // sizes from half the SDF font size up are drawn from the atlas instead of rasterized
+    const char *text = "AVATAR - WAVE To VA\nThe quick brown fox jumps over the lazy dog.";
+    Image image = KernText(text, font, 96);
+    Texture2D texture = LoadTextureFromImage(image);
+
+    SetTargetFPS(60);
+
+    while (!WindowShouldClose()) {
+        float fontSize = 64 + 48 * sinf(GetTime());
+
+        BeginDrawing();
+            ClearBackground(BLACK);
+
+            BeginShaderMode(shader);
+                DrawTextSdfWithKerning(font, atlas, text, (Vector2){ 20, 20 }, fontSize, WHITE);
+            EndShaderMode();
+            DrawTexture(texture, 20, 600, WHITE);
+        EndDrawing();
+    }
+
+    UnloadImage(image);
+    UnloadTexture(texture);
+    UnloadTexture(atlas);
+    UnloadShader(shader);
+    UnloadFontWithKerning(font);
+    CloseWindow();
+
+    return 0;
+}
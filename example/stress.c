@@ -0,0 +1,127 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RLTEXTKERNER_NO_RAYLIB
+#define RLTEXTKERNER_IMPLEMENTATION
+#include "rltextkerner.h"
+
+// stress test of kerning text with one font from many threads at once, meant to be built with a thread sanitizer
+// (make stress builds it with -fsanitize=thread)
+//
+// usage: ./stress [threads] [passes]
+//
+// Each thread renders every text at every size, wrap & subpixel setting, starting from a different one so the threads
+// render different strings at the same time & miss different glyphs of the cache. Every image is compared to one
+// rendered on the main thread beforehand. This runs once with an unlimited glyph cache, & once with a cache limit small
+// enough that glyphs are evicted while other threads draw them.
+
+static const char *texts[] = {
+    "Hello, World!",
+    "AVATAR WAVE To Ty Yo",
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Mauris semper tellus ante, in consectetur lacus pretium in.",
+    "The quick brown fox jumps over the lazy dog. 0123456789 !@#$%^&*()[]{}",
+    "Ελληνικά κείμενα και Кириллица текст",
+    "☥ ★ ☆ → ← ∑ ∞ ≈ ≠ © ® ™ € £",
+};
+
+static const float fontSizes[] = { 12, 16.5f, 24, 31.25f };
+
+#define COUNT_OF(array) ((int) (sizeof(array) / sizeof((array)[0])))
+#define RUN_COUNT (COUNT_OF(texts) * COUNT_OF(fontSizes) * 4)
+#define MAX_WIDTH 600
+#define MAX_HEIGHT 400
+#define CACHE_LIMIT (64 * 1024)
+
+static FontWithKerning font;
+static Image references[RUN_COUNT];
+static int passCount = 4;
+
+typedef struct StressThread {
+    pthread_t thread;
+    int index;
+    int failures;
+} StressThread;
+
+static Image RenderRun(int run)
+{
+    int text = run % COUNT_OF(texts);
+    int size = run / COUNT_OF(texts) % COUNT_OF(fontSizes);
+    int wrap = run / (COUNT_OF(texts) * COUNT_OF(fontSizes)) % 2;
+    int subpixel = run / (COUNT_OF(texts) * COUNT_OF(fontSizes) * 2);
+
+    return KernTextEx(texts[text], font, fontSizes[size], MAX_WIDTH, MAX_HEIGHT, wrap, subpixel);
+}
+
+static void *RenderRuns(void *data)
+{
+    StressThread *thread = data;
+    for (int pass = 0; pass < passCount; pass++) {
+        for (int i = 0; i < RUN_COUNT; i++) {
+            int run = (i + thread->index * 7) % RUN_COUNT;
+            Image image = RenderRun(run);
+            const Image *reference = &references[run];
+            if (image.width != reference->width || image.height != reference->height ||
+                memcmp(image.data, reference->data, (size_t) image.width * image.height) != 0) {
+                ++thread->failures;
+            }
+            UnloadImage(image);
+        }
+    }
+    UnloadKernTextScratch();
+
+    return NULL;
+}
+
+static int RunThreads(int threadCount)
+{
+    StressThread *threads = calloc(threadCount, sizeof(*threads));
+    for (int i = 0; i < threadCount; i++) {
+        threads[i].index = i;
+        pthread_create(&threads[i].thread, NULL, RenderRuns, &threads[i]);
+    }
+
+    int failures = 0;
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(threads[i].thread, NULL);
+        failures += threads[i].failures;
+    }
+    free(threads);
+
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    int threadCount = argc > 1 ? atoi(argv[1]) : 8;
+    if (argc > 2) passCount = atoi(argv[2]);
+
+    SetTraceLogLevel(LOG_WARNING);
+    font = LoadFontWithKerning("font/DejaVuSans.ttf", 16);
+    if (!font.info) {
+        fprintf(stderr, "unable to load the font - run the stress test from the example folder\n");
+        return 1;
+    }
+    for (int i = 0; i < RUN_COUNT; i++) references[i] = RenderRun(i);
+
+    int failures = 0;
+    for (int limited = 0; limited <= 1; limited++) {
+        // start each run with an empty cache, so the threads rasterize glyphs at the same time
+        UnloadFontWithKerning(font);
+        font = LoadFontWithKerning("font/DejaVuSans.ttf", 16);
+        SetFontWithKerningCacheLimit(font, limited ? CACHE_LIMIT : 0);
+
+        int runFailures = RunThreads(threadCount);
+        FontWithKerningMemoryUsage usage = GetFontWithKerningMemoryUsage(font);
+        printf("%d threads, cache limit %d: %d images differ, %d glyphs cached, %llu evicted\n",
+               threadCount, limited ? CACHE_LIMIT : 0, runFailures, usage.cachedGlyphs, usage.evictions);
+        failures += runFailures;
+    }
+
+    for (int i = 0; i < RUN_COUNT; i++) UnloadImage(references[i]);
+    UnloadFontWithKerning(font);
+    UnloadKernTextScratch();
+
+    return failures > 0 ? 1 : 0;
+}
@@ -3,15 +3,99 @@
 
 #ifdef RLTEXTKERNER_IMPLEMENTATION
     #define STB_TRUETYPE_IMPLEMENTATION
+    // stb_truetype allocates from per-thread scratch memory while glyphs are rasterized for kerned text, so rendering
+    // does no allocations once the scratch memory has grown to fit (unless STBTT_malloc is defined by the user)
+    #if !defined(STBTT_malloc)
+        #include <stddef.h>
+        #define RLTEXTKERNER_ARENA
+        #define STBTT_malloc(x,u)   ((void)(u),AllocKernArenaWithKerning(x))
+        #define STBTT_free(x,u)     ((void)(u),FreeKernArenaWithKerning(x))
+        static void *AllocKernArenaWithKerning(size_t size);
+        static void FreeKernArenaWithKerning(void *ptr);
+    #endif
+#endif
+// Define RLTEXTKERNER_NO_RAYLIB to build without raylib (e.g. for servers or benchmarks without a window) - the
+// library then provides the few raylib types & functions it uses itself (see below).
+#if !defined(RLTEXTKERNER_NO_RAYLIB)
+    #include "raylib.h"
+#else
+    #include <stdbool.h>
+    #include <stdlib.h>
 #endif
-#include "raylib.h"
 #include "stb_truetype.h"
 #include <assert.h>
+#include <stddef.h>
 
 #if defined(__cplusplus)
 extern "C" {            // Prevents name mangling of functions
 #endif
 
+#if defined(RLTEXTKERNER_NO_RAYLIB)
+#ifndef RL_MALLOC
+    #define RL_MALLOC(sz)       malloc(sz)
+#endif
+#ifndef RL_CALLOC
+    #define RL_CALLOC(n,sz)     calloc(n,sz)
+#endif
+#ifndef RL_REALLOC
+    #define RL_REALLOC(ptr,sz)  realloc(ptr,sz)
+#endif
+#ifndef RL_FREE
+    #define RL_FREE(ptr)        free(ptr)
+#endif
+
+// Max size of the images made by KernText & KernTextWrapped, which use the screen size when built with raylib
+#ifndef RLTEXTKERNER_MAX_TEXT_WIDTH
+    #define RLTEXTKERNER_MAX_TEXT_WIDTH 4096
+#endif
+#ifndef RLTEXTKERNER_MAX_TEXT_HEIGHT
+    #define RLTEXTKERNER_MAX_TEXT_HEIGHT 4096
+#endif
+
+// Image, same layout as the raylib Image
+typedef struct Image {
+    void *data;             // Image raw data
+    int width;              // Image base width
+    int height;             // Image base height
+    int mipmaps;            // Mipmap levels, 1 by default
+    int format;             // Data format (PixelFormat type)
+} Image;
+
+// Rectangle, same layout as the raylib Rectangle
+typedef struct Rectangle {
+    float x;                // Rectangle top-left corner position x
+    float y;                // Rectangle top-left corner position y
+    float width;            // Rectangle width
+    float height;           // Rectangle height
+} Rectangle;
+
+// Trace log level, same values as raylib
+typedef enum {
+    LOG_ALL = 0,
+    LOG_TRACE,
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR,
+    LOG_FATAL,
+    LOG_NONE
+} TraceLogLevel;
+
+// Pixel format, same values as raylib (only grayscale images are made by the library)
+typedef enum {
+    PIXELFORMAT_UNCOMPRESSED_GRAYSCALE = 1
+} PixelFormat;
+
+void TraceLog(int logLevel, const char *text, ...);                 // Show trace log message on stderr
+void SetTraceLogLevel(int logLevel);                                // Set the minimum log level shown (LOG_INFO by default)
+unsigned char *LoadFileData(const char *fileName, int *dataSize);  // Load file data as byte array
+void UnloadFileData(unsigned char *data);                          // Unload file data allocated by LoadFileData()
+bool IsFileExtension(const char *fileName, const char *ext);       // Check file extension (including point: .ttf)
+int *LoadCodepoints(const char *text, int *count);                 // Load all codepoints from a UTF-8 text string
+void UnloadCodepoints(int *codepoints);                            // Unload codepoints data from memory
+void UnloadImage(Image image);                                     // Unload image from CPU memory (RAM)
+#endif
+
 /**
  * Copyright (c) 2024 Michael Mackus
  *
@@ -38,13 +122,34 @@ typedef struct GlyphWithKerning {
     Image *images; // Character raw bitmap data for different font sizes
 } GlyphWithKerning;
 
-// Font, font texture and GlyphInfo array data
+// Glyph bitmaps rendered on demand, shared by all copies of a font (see the thread safety notes below)
+typedef struct GlyphCacheWithKerning GlyphCacheWithKerning;
+
+// Font, font texture and glyph data - the glyph data is stored as parallel arrays, so reading one field of many glyphs
+// (e.g. their advances) doesn't load the others. Use GetGlyphWithKerning to get all the data of one glyph.
 typedef struct FontWithKerning {
     int glyphCount;           // Number of glyph characters
-    GlyphWithKerning *glyphs;  // Glyph data for faster bitmap generation
+    int *codepoints;          // Character value (Unicode) of each glyph - the other glyph arrays share its memory
+    int *glyphIndices;        // Glyph index in the font info of each glyph
+    int *advances;            // Advance position X of each glyph, unscaled
+    int *bearings;            // Left side bearing of each glyph, unscaled
     stbtt_fontinfo *info;     // Font info from stb_truetype
+    GlyphCacheWithKerning *cache; // Pre-rendered glyph bitmaps, plus bitmaps for the sizes & subpixel positions that aren't
 } FontWithKerning;
 
+GlyphWithKerning GetGlyphWithKerning(FontWithKerning font, int codepoint); // Get glyph data & pre-rendered bitmaps for codepoint (index 0 if not loaded)
+int GetGlyphIndexWithKerning(FontWithKerning font, int codepoint); // Get glyph index in the font info for codepoint (0 if the font has no glyph for it)
+
+// Thread safety: a loaded font is read-only while rendering, so any number of threads may call the KernText functions
+// with the same font at once. Glyph bitmaps that were not pre-rendered are rasterized on demand & stored in the font's
+// glyph cache - lookups in the cache take no locks, and a miss only locks the part (shard) of the cache the new bitmap
+// goes into. Cached bitmaps are never changed, and are only freed once no thread is drawing them. Each thread keeps
+// scratch memory for kerning its strings (see UnloadKernTextScratch), so steady rendering only allocates the images.
+//
+// Loading, updating (UpdateFontWithKerningBitmaps) and unloading a font are NOT safe while other threads render with it.
+// Unloading a copy made with CopyFontWithKerning is, as long as another copy is still loaded. Fonts loaded from the same
+// file share its data, but can be loaded & unloaded on any thread while the others are in use.
+
 // Load font from file - only supports TTF or OTF. NOTE: if the info property is NULL in the returned struct, there was
 // an error during loading.
 FontWithKerning LoadFontWithKerning(const char *fileName, int baseFontSize);
@@ -57,241 +162,3960 @@ FontWithKerning LoadFontWithKerningEx(const char *fileName, int baseFontSize, co
 // there was an error during loading.
 //
 // NOTE: The fileData pointer must remain valid for the life of the font. Calling UnloadFontWithKerning will free this data.
+// Fonts loaded from the same data share one copy of it (& the font info): if a loaded font already uses data with the
+// same contents, fileData is freed right away & the new font uses the loaded data instead.
 FontWithKerning LoadFontWithKerningFromMemory(const unsigned char *fileData, int baseFontSize, int dataSize, const int *codepoints, int codepointCount);
 
 // Update font with bitmaps for the font size - this way KernText functions operate much faster at that size.
 void UpdateFontWithKerningBitmaps(FontWithKerning *font, int fontSize);
 
-// Free the font data
+// Update font with bitmaps for several font sizes at once, spreading the glyph rasterization across a pool of worker
+// threads (threadCount <= 0 uses one thread per CPU core). Bitmaps are stored in the same order as calling
+// UpdateFontWithKerningBitmaps for each size in turn, regardless of the thread count.
+void UpdateFontWithKerningBitmapsEx(FontWithKerning *font, const int *fontSizes, int fontSizeCount, int threadCount);
+
+// Set the number of worker threads used when loading fonts & updating font bitmaps (0 = one per CPU core, default).
+void SetFontWithKerningThreadCount(int threadCount);
+
+// Rasterizers for glyph bitmaps, both pre-rendered & rendered into the glyph cache
+typedef enum {
+    KERN_RASTERIZER_STB = 0,    // stb_truetype's scanline rasterizer (default)
+    KERN_RASTERIZER_ACCUMULATE, // signed area accumulation - faster, with coverage within a few levels of stb_truetype's
+} KernRasterizer;
+
+// Set the rasterizer for glyph bitmaps rendered from now on (bitmaps already rendered are kept). Set it before rendering.
+void SetKernRasterizer(int rasterizer);
+
+// Set the fonts to draw codepoints the font has no glyph for (e.g. symbols or other scripts), tried in order - count 0
+// removes them. Only the font's own fallbacks are used, not those of its fallbacks. The fallback fonts must stay loaded
+// while text is kerned with the font. Like updating, this is NOT safe while other threads render with the font.
+void SetFontWithKerningFallbacks(FontWithKerning font, const FontWithKerning *fallbacks, int count);
+
+// Get a copy of the font that shares all of its data, for code that unloads its fonts itself (e.g. another thread).
+// The font data is freed once the font & all of its copies have been unloaded.
+FontWithKerning CopyFontWithKerning(FontWithKerning font);
+
+// Free the font data (shared font data is kept until all fonts & copies using it are unloaded)
 void UnloadFontWithKerning(FontWithKerning font);
 
-Image KernText(const char *text, FontWithKerning font, int fontSize); // Kern text and produce greyscale image.
-Image KernTextWrapped(const char *text, FontWithKerning font, int fontSize, int maxWidth); // Kern text word wrapped to a max width (maxWidth = max width in pixels).
-Image KernTextEx(const char *text, FontWithKerning font, int fontSize, int maxWidth, int maxHeight, int wrap, int subpixel); // Kern text advanced within maxWidth & maxHeight.
-Image KernCodepoints(const int *codepoints, int codepointsCount, FontWithKerning font, int fontSize, int maxWidth, int maxHeight, int wrap, int subpixel); // Kern UTF-8 codepoints (called via the above functions)
+// Counters & timers for the work done while kerning text with a font (shared by all copies of the font). They are only
+// collected when the library is compiled with RLTEXTKERNER_STATS defined - otherwise they cost nothing & stay zero.
+// Timers read the clock several times per glyph, so expect kerning to be slower while they are enabled.
+typedef struct FontWithKerningStats {
+    unsigned long long strings;          // strings kerned
+    unsigned long long glyphLookups;     // codepoints looked up in the font glyphs
+    unsigned long long cacheHits;        // glyph bitmaps found in the glyph cache
+    unsigned long long cacheMisses;      // glyph bitmaps added to the glyph cache
+    unsigned long long rasterizations;   // glyph bitmaps rasterized by stb_truetype (misses without a pre-rendered bitmap)
+    unsigned long long kerningQueries;   // kerning pairs looked up
+    unsigned long long bytesAllocated;   // bytes allocated for cached glyphs, text bitmaps & text images
+    unsigned long long pixelsComposited; // glyph pixels drawn into text bitmaps
+    unsigned long long totalTime;        // nanoseconds spent kerning strings, including all the phases below
+    unsigned long long lookupTime;       // nanoseconds spent finding glyphs & their cached bitmaps
+    unsigned long long kerningTime;      // nanoseconds spent looking up kerning pairs
+    unsigned long long boundingBoxTime;  // nanoseconds spent measuring glyph bitmaps on cache misses
+    unsigned long long rasterTime;       // nanoseconds spent rasterizing glyph bitmaps on cache misses
+    unsigned long long compositeTime;    // nanoseconds spent drawing glyphs & copying text bitmaps into images
+} FontWithKerningStats;
+
+FontWithKerningStats GetFontWithKerningStats(FontWithKerning font); // Get font counters collected since loading or the last reset
+void ResetFontWithKerningStats(FontWithKerning font); // Set all font counters back to zero
+
+// Number of distinct missing codepoints counted for each font (a power of two) - others are drawn but not counted
+#ifndef RLTEXTKERNER_MAX_MISSING_GLYPHS
+    #define RLTEXTKERNER_MAX_MISSING_GLYPHS 256
+#endif
+
+// codepoint kerned with a font that neither it nor its fallbacks have a glyph for - it is drawn as the missing glyph, &
+// logged only the first time
+typedef struct MissingGlyphWithKerning {
+    int codepoint;
+    unsigned long long count;        // times the codepoint was kerned
+} MissingGlyphWithKerning;
+
+// Get the codepoints missing from the font (safe while rendering), returns how many there are - only the first maxCount
+// are stored in missing
+int GetFontWithKerningMissingGlyphs(FontWithKerning font, MissingGlyphWithKerning *missing, int maxCount);
+void ResetFontWithKerningMissingGlyphs(FontWithKerning font); // Forget the missing codepoints, so they are logged again (NOT safe while rendering)
+
+// Number of distinct glyphs (codepoint, size & subpixel phase) counted while recording a profile (a power of two)
+#ifndef RLTEXTKERNER_PROFILE_GLYPHS
+    #define RLTEXTKERNER_PROFILE_GLYPHS 4096
+#endif
+
+// Number of font sizes tracked for memory usage & eviction - sizes beyond this count as the least recently used
+#ifndef RLTEXTKERNER_MAX_FONT_SIZES
+    #define RLTEXTKERNER_MAX_FONT_SIZES 32
+#endif
+
+// memory used for one font size
+typedef struct FontWithKerningSizeUsage {
+    float fontSize;                  // font size, or size step glyph bitmaps are shared within (SetFontWithKerningSizeStep)
+    int cachedGlyphs;                // glyph bitmaps in the glyph cache (all subpixel phases)
+    size_t bitmapBytes;              // pre-rendered glyph bitmaps (UpdateFontWithKerningBitmaps)
+    size_t cacheBytes;               // glyph bitmaps in the glyph cache
+    unsigned long long lastUse;      // when text was last kerned at this size (higher = more recent, 0 = never)
+} FontWithKerningSizeUsage;
+
+// memory used by a font, in bytes
+typedef struct FontWithKerningMemoryUsage {
+    size_t fontData;                 // TTF/OTF file data (shared with other fonts loaded from the same data)
+    size_t kerningTables;            // kern & GPOS tables (part of fontData)
+    size_t metrics;                  // font info, cmap, glyph metrics, kerning pairs & image arrays
+    size_t outlines;                 // glyph outlines decoded for rasterizing (shared like fontData)
+    size_t bitmaps;                  // pre-rendered glyph bitmaps
+    size_t sdfAtlas;                 // SDF atlas image & glyph rectangles
+    size_t diskCache;                // disk cache files mapped into memory (not in total - the OS pages them in & out)
+    size_t sharedCache;              // shared cache segment used by all the processes sharing it (not in total)
+    size_t glyphCache;               // glyph cache bitmaps & hash tables
+    size_t total;                    // all of the above (not counting kerningTables twice)
+    size_t glyphCacheLimit;          // limit set with SetFontWithKerningCacheLimit (0 = no limit)
+    int cachedGlyphs;                // glyph bitmaps in the glyph cache
+    int pinnedGlyphs;                // cached glyph bitmaps pinned with PinFontWithKerningText
+    unsigned long long evictions;    // glyph bitmaps evicted to keep the glyph cache within its limit
+    int sizeCount;                   // number of sizes in sizes
+    FontWithKerningSizeUsage sizes[RLTEXTKERNER_MAX_FONT_SIZES]; // usage of each pre-rendered or kerned font size
+} FontWithKerningMemoryUsage;
+
+FontWithKerningMemoryUsage GetFontWithKerningMemoryUsage(FontWithKerning font); // Get font memory usage (safe while rendering)
+
+// Set the most memory the font should use (0 = no limit, default). When it is over the budget, the bitmaps for the font
+// sizes used least recently are freed, both pre-rendered & cached (they are rendered again if needed). This happens in
+// UpdateFontWithKerningBitmaps, SetFontWithKerningMemoryBudget & TrimFontWithKerningMemory, which like updating are NOT
+// safe while other threads render with the font - call TrimFontWithKerningMemory at a point where no text is kerned,
+// e.g. once per frame, to apply the budget to bitmaps cached while rendering.
+void SetFontWithKerningMemoryBudget(FontWithKerning *font, size_t budget);
+size_t TrimFontWithKerningMemory(FontWithKerning *font); // Free old cache tables & bitmaps over the budget, returns bytes freed
+
+// Limit the memory used by glyph bitmaps in the glyph cache (0 = no limit, default). Unlike the memory budget, this holds
+// while rendering: when the cache is full, glyphs not used recently are evicted to make room, while glyphs still being
+// drawn by other threads stay valid until they are done. Setting the limit is NOT safe while rendering with the font.
+void SetFontWithKerningCacheLimit(FontWithKerning font, size_t limit);
+
+// Font sizes can be fractional, e.g. for zooming & UI scaling. Glyph bitmaps are shared between the sizes nearest to
+// the same multiple of the size step (1/4 pixel by default), so animating the size doesn't rasterize every glyph again
+// each frame - glyphs are rasterized at the nearest step, while glyph advances & kerning still use the exact font size.
+// Steps that divide 1 keep whole font sizes exact (so they use bitmaps pre-rendered at that size). NOT safe while
+// rendering with the font.
+void SetFontWithKerningSizeStep(FontWithKerning font, float step); // Set the size step in pixels (0 = smallest, 1/64 pixel)
+
+// Disk cache - glyph bitmaps rasterized into the glyph cache are saved to files in an existing directory, one per font
+// data hash & size step, when the font is unloaded (or with SaveFontWithKerningDiskCache). The next time the same font
+// data misses a glyph at that size, the file is mapped into memory & the glyph's bitmap is used from it instead of being
+// rasterized. Files from different font data, rasterizers or subpixel settings are ignored (& replaced when saving).
+// Setting the directory is NOT safe while rendering with the font; saving is.
+void SetFontWithKerningDiskCache(FontWithKerning font, const char *directory); // Set the directory (NULL = no disk cache, default)
+bool SaveFontWithKerningDiskCache(FontWithKerning font); // Save the glyphs not in the disk cache yet, returns true on success
+
+// Shared cache - processes on the same machine that render the same font data can share their glyph bitmaps through a
+// named shared memory segment (POSIX shm, e.g. "/mygame-glyphs", or a named file mapping on Windows): glyphs missing
+// from the glyph cache are looked up there before rasterizing, & glyphs rasterized are added for the other processes.
+// The first process to open the segment creates it with the given size, & it stays until RemoveKernSharedCache (or a
+// reboot) - once it is full, glyphs are rasterized by each process again. Set it right after loading the font, before
+// UpdateFontWithKerningBitmaps (pre-rendered bitmaps aren't shared, so leave sizes to the shared cache instead).
+bool SetFontWithKerningSharedCache(FontWithKerning font, const char *name, size_t size); // Use the shared cache segment, creating it if needed (once per font)
+void RemoveKernSharedCache(const char *name); // Remove the segment name - processes using it keep it until they unload their fonts
+void PinFontWithKerningText(FontWithKerning font, const char *text, float fontSize, int subpixel); // Keep the glyph bitmaps for text in the cache until unpinned, rendering them if needed
+void UnpinFontWithKerningText(FontWithKerning font, const char *text, float fontSize, int subpixel); // Allow glyph bitmaps pinned with the same arguments to be evicted again
+
+// Glyph profiles - while recording, the font counts how often each codepoint is drawn at each size & subpixel phase.
+// Export the counts to a profile file, & on the next start prewarm the font from it: the most used glyphs are rendered
+// into the glyph cache on a background thread, most used first, while the game starts up. Prewarming counts as
+// rendering with the font, so wait until IsFontWithKerningPrewarming is false before calls that are NOT safe while
+// rendering (unloading the font stops the prewarm first).
+void SetFontWithKerningProfileRecording(FontWithKerning font, bool record); // Start or stop counting drawn glyphs (NOT safe while rendering)
+bool ExportFontWithKerningProfile(FontWithKerning font, const char *fileName); // Save the glyph counts as a text profile, most used first
+bool PrewarmFontWithKerning(FontWithKerning font, const char *fileName, int maxGlyphs); // Render the most used glyphs of a profile in the background (maxGlyphs <= 0 = all)
+bool IsFontWithKerningPrewarming(FontWithKerning font); // Check if a prewarm is still rendering glyphs
+
+// Corpus subsetting - when all the text a game shows is known ahead of time, load the font with only the codepoints the
+// corpus uses, pre-rendered at each of its sizes, & look up the kerning of each glyph pair next to each other in the
+// corpus once at load. Kerning those pairs is then a hash table lookup rather than a search through the kern & GPOS
+// tables. Text outside the corpus still renders, its glyphs & kerning just aren't prepared ahead of time.
+FontWithKerning LoadFontWithKerningFromCorpus(const char *fileName, const char **texts, int textCount, const int *fontSizes, int fontSizeCount); // Load the corpus codepoints & pairs (fontSizes[0] is the base size)
+void UpdateFontWithKerningPairs(FontWithKerning font, const char **texts, int textCount); // Replace the kerning pairs with those of the texts (count 0 removes them, NOT safe while rendering)
+
+// Signed distance fields - UpdateFontWithKerningSdf renders a distance field of each font glyph into one atlas image, at
+// one font size. Glyph bitmaps for sizes that weren't pre-rendered are then drawn from the atlas by thresholding the
+// distance at each pixel instead of being rasterized, for sizes from half the atlas font size up (distance fields alias
+// when shrunk further, so smaller sizes are still rasterized). Like updating, this is NOT safe while rendering with the font.
+void UpdateFontWithKerningSdf(FontWithKerning *font, int fontSize); // Render the SDF atlas at font size (0 = remove the atlas)
+Image GetFontWithKerningSdfAtlas(FontWithKerning font); // Get the SDF atlas image (grayscale, 128 on glyph edges) - owned by the font
+
+#if !defined(RLTEXTKERNER_NO_RAYLIB)
+// Draw text at any size on the GPU from the SDF atlas uploaded with LoadTextureFromImage - draw inside BeginShaderMode
+// with the SDF shader (GLSL 330), which turns the distances into edges that stay smooth at the size drawn.
+Shader LoadSdfShaderWithKerning(void);
+void DrawTextSdfWithKerning(FontWithKerning font, Texture2D atlas, const char *text, Vector2 position, float fontSize, Color tint);
+#endif
+
+// Trace spans - recorded only when the library is compiled with RLTEXTKERNER_TRACE defined. Events go into a ring buffer
+// of the last RLTEXTKERNER_TRACE_EVENTS events (written without locks from any thread), which ExportKernTrace saves as
+// Chrome trace JSON for chrome://tracing or Perfetto. Install a callback to receive the events instead.
+typedef enum {
+    KERN_TRACE_LOAD = 0,    // LoadFontWithKerning functions (fontSize = base font size, glyphCount)
+    KERN_TRACE_UPDATE,      // UpdateFontWithKerningBitmaps functions (fontSize = first font size, glyphCount)
+    KERN_TRACE_LAYOUT,      // kerning one string (textLength, fontSize, glyphCount = glyphs drawn, cacheMisses)
+    KERN_TRACE_RASTERIZE,   // rasterizing glyph bitmaps on one thread (glyphCount, fontSize for glyph cache misses)
+    KERN_TRACE_COMPOSITE,   // copying a kerned string into its image (fontSize, glyphCount = glyphs drawn)
+    KERN_TRACE_FRAME,       // frame marker added by MarkKernTraceFrame
+} KernTraceSpan;
+
+typedef struct KernTraceEvent {
+    int span;                   // KernTraceSpan
+    char phase;                 // 'B' at the start of the span, 'E' at the end, 'i' for markers (Chrome trace phases)
+    int thread;                 // small id for the thread recording the event (1 = first thread to record one)
+    unsigned long long time;    // monotonic time in nanoseconds (see GetKernTraceTime)
+    int textLength;             // span arguments - 0 where they don't apply
+    int fontSize;
+    int glyphCount;
+    int cacheMisses;
+} KernTraceEvent;
+
+typedef void (*KernTraceCallback)(const KernTraceEvent *event, void *userData);
+
+void SetKernTraceCallback(KernTraceCallback callback, void *userData); // Send events to callback instead of the ring buffer (NULL = ring buffer)
+bool ExportKernTrace(const char *fileName); // Save the ring buffer events as Chrome trace JSON, returns true on success
+void ClearKernTrace(void); // Remove all events from the ring buffer
+void MarkKernTraceFrame(void); // Record a frame marker, to line spans up with frames in the trace
+unsigned long long GetKernTraceTime(void); // Get the current time on the trace clock, in nanoseconds
+
+Image KernText(const char *text, FontWithKerning font, float fontSize); // Kern text and produce greyscale image.
+Image KernTextWrapped(const char *text, FontWithKerning font, float fontSize, int maxWidth); // Kern text word wrapped to a max width (maxWidth = max width in pixels).
+Image KernTextEx(const char *text, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel); // Kern text advanced within maxWidth & maxHeight.
+Image KernCodepoints(const int *codepoints, int codepointsCount, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel); // Kern UTF-8 codepoints (called via the above functions)
+
+// Kern many strings with the same settings in one call, sharing the font metrics & scratch memory between strings and
+// spreading them across threadCount threads (<= 0 = one per CPU core). Writes one image per text to images.
+void KernTextBatch(const char **texts, int count, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel, int threadCount, Image *images);
+
+// Free the scratch memory the calling thread keeps between KernText calls (the text bitmap, codepoints & memory for
+// rasterizing glyphs). Call it before ending a thread that kerned text, or to give the memory back after kerning large
+// text - threads started by the library do this themselves. The memory is allocated again by the next call.
+void UnloadKernTextScratch(void);
+
+// Atlas of kerned text labels packed into shelves (rows) of one image, so many labels can be drawn from a single
+// texture. Upload the image once with LoadTextureFromImage, then use UpdateTexture whenever modified is set. Draw labels
+// with DrawTextureRec using the rectangle of each label. Removed labels free their space for new labels.
+typedef struct LabelShelfWithKerning LabelShelfWithKerning;
+
+typedef struct LabelAtlasWithKerning {
+    Image image;                    // Atlas image containing all labels (grayscale)
+    int labelCount;                 // Number of label ids handed out (including removed labels)
+    Rectangle *labels;              // Rectangle of each label in the image (zero size once removed)
+    int shelfCount;                 // Number of shelves in the image
+    LabelShelfWithKerning *shelves; // Shelves the labels are packed into
+    int modified;                   // Set whenever the image changes - clear it after updating the texture
+} LabelAtlasWithKerning;
+
+// Label id of empty images & texts (e.g. only spaces) - they take no space in the atlas & there is nothing to draw
+#define KERN_LABEL_EMPTY (-2)
+
+LabelAtlasWithKerning LoadLabelAtlasWithKerning(int width, int height); // Load empty atlas (image data is NULL on error)
+void UnloadLabelAtlasWithKerning(LabelAtlasWithKerning atlas); // Free the atlas image & labels
+int AddLabelAtlasImage(LabelAtlasWithKerning *atlas, Image image); // Copy grayscale image into the atlas, returns label id (-1 if the atlas is full, KERN_LABEL_EMPTY if the image is)
+int AddLabelAtlasText(LabelAtlasWithKerning *atlas, const char *text, FontWithKerning font, float fontSize, int maxWidth, int wrap); // Kern text into the atlas, returns label id (-1 if the atlas is full, KERN_LABEL_EMPTY if the text is)
+void AddLabelAtlasTexts(LabelAtlasWithKerning *atlas, const char **texts, int count, FontWithKerning font, float fontSize, int maxWidth, int wrap, int *labels); // Kern many texts into the atlas (with KernTextBatch), storing a label id for each
+void RemoveLabelAtlasLabel(LabelAtlasWithKerning *atlas, int label); // Remove label & clear its pixels, freeing its space for new labels
+
+// Queue for rendering text in the background with KernTextEx on a pool of worker threads, so long text doesn't stall
+// the game loop. Submitting returns a job handle right away - poll or wait for the job to get its image, then upload it
+// on the main thread (e.g. with LoadTextureFromImage). Fonts must stay loaded until all of their jobs have finished.
+typedef struct KernTextQueue KernTextQueue;
+
+typedef struct KernTextQueueStats {
+    int pendingCount;        // Jobs waiting for a worker thread
+    int runningCount;        // Jobs being rendered
+    int finishedCount;       // Jobs rendered but not yet collected with PollKernText or WaitKernText
+    int completedCount;      // Total jobs rendered since the queue was loaded
+    double averageLatency;   // Average seconds from submitting a job until its image was ready
+    double maxLatency;       // Longest seconds from submitting a job until its image was ready
+} KernTextQueueStats;
+
+KernTextQueue *LoadKernTextQueue(int threadCount); // Start queue with threadCount worker threads (<= 0 = one per CPU core), returns NULL on error
+void UnloadKernTextQueue(KernTextQueue *queue); // Wait for running jobs, then free the queue along with any images not yet collected
+int SubmitKernText(KernTextQueue *queue, const char *text, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel); // Queue KernTextEx job without blocking, returns job handle (0 on error)
+int PollKernText(KernTextQueue *queue, int job, Image *image); // Returns 1 and sets image once the job is finished (the job handle is then no longer valid)
+Image WaitKernText(KernTextQueue *queue, int job); // Wait for the job to finish & return its image (the job handle is then no longer valid)
+KernTextQueueStats GetKernTextQueueStats(KernTextQueue *queue); // Get queue depth & latency
 
 #ifdef RLTEXTKERNER_IMPLEMENTATION
 
-Image CreateGlyphImageWithKerning(FontWithKerning font, int codepoint, float fontScale)
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Define RLTEXTKERNER_NO_THREADS to run all glyph rasterization on the calling thread
+#if !defined(RLTEXTKERNER_NO_THREADS)
+    #if defined(_WIN32)
+        // declared here instead of including windows.h, which clashes with raylib names (Rectangle, DrawText, etc.)
+        __declspec(dllimport) void *__stdcall CreateThread(void *threadAttributes, size_t stackSize, unsigned long (__stdcall *startAddress)(void *), void *parameter, unsigned long creationFlags, unsigned long *threadId);
+        __declspec(dllimport) unsigned long __stdcall WaitForSingleObject(void *handle, unsigned long milliseconds);
+        __declspec(dllimport) int __stdcall CloseHandle(void *handle);
+        __declspec(dllimport) unsigned long __stdcall GetActiveProcessorCount(unsigned short groupNumber);
+    #else
+        #include <pthread.h>
+        #include <unistd.h>
+    #endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RLTEXTKERNER_SSE2
+    #include <emmintrin.h>
+#endif
+#if defined(_WIN32)
+    __declspec(dllimport) int __stdcall QueryPerformanceCounter(long long *count);
+    __declspec(dllimport) int __stdcall QueryPerformanceFrequency(long long *frequency);
+    __declspec(dllimport) void __stdcall Sleep(unsigned long milliseconds);
+    __declspec(dllimport) void *__stdcall CreateFileA(const char *fileName, unsigned long access, unsigned long shareMode, void *securityAttributes, unsigned long creation, unsigned long flags, void *templateFile);
+    __declspec(dllimport) int __stdcall GetFileSizeEx(void *file, long long *size);
+    __declspec(dllimport) void *__stdcall CreateFileMappingA(void *file, void *attributes, unsigned long protect, unsigned long sizeHigh, unsigned long sizeLow, const char *name);
+    __declspec(dllimport) void *__stdcall MapViewOfFile(void *mapping, unsigned long access, unsigned long offsetHigh, unsigned long offsetLow, size_t size);
+    __declspec(dllimport) int __stdcall UnmapViewOfFile(const void *address);
+    __declspec(dllimport) int __stdcall MoveFileExA(const char *existingFileName, const char *newFileName, unsigned long flags);
+    __declspec(dllimport) int __stdcall CloseHandle(void *handle);
+#else
+    #include <time.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+#include <stdio.h>
+
+#define RLTEXTKERNER_MAX_THREADS 64
+#define RLTEXTKERNER_MAX_FALLBACKS 8   // fallback fonts for each font
+#define RLTEXTKERNER_CACHE_SHARDS 16   // independently locked parts of the glyph cache
+
+// number of subpixel positions cached for each glyph & font size when rendering with subpixel enabled
+#ifndef RLTEXTKERNER_SUBPIXEL_PHASES
+    #define RLTEXTKERNER_SUBPIXEL_PHASES 4
+#endif
+
+// Define RLTEXTKERNER_STATS to collect FontWithKerningStats - statements wrapped in this are removed otherwise
+#if defined(RLTEXTKERNER_STATS)
+    #define RLTEXTKERNER_STAT(...) __VA_ARGS__
+#else
+    #define RLTEXTKERNER_STAT(...)
+#endif
+
+static int fontThreadCount = 0; // worker threads used for font loading (0 = one per CPU core)
+static atomic_int glyphRasterizer = KERN_RASTERIZER_STB;
+
+typedef struct WorkerWithKerning {
+    void (*proc)(void *);
+    void *arg;
+#if !defined(RLTEXTKERNER_NO_THREADS)
+    #if defined(_WIN32)
+    void *handle;
+    #else
+    pthread_t handle;
+    #endif
+#endif
+} WorkerWithKerning;
+
+#if !defined(RLTEXTKERNER_NO_THREADS)
+    #if defined(_WIN32)
+static unsigned long __stdcall WorkerProcWithKerning(void *arg)
 {
-    Image image = { 0 };
-    image.data = stbtt_GetGlyphBitmap(font.info,
-                        fontScale,
-                        fontScale,
-                        stbtt_FindGlyphIndex(font.info, codepoint),
-                        &image.width,
-                        &image.height,
-                        NULL,
-                        NULL);
-    image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
-    image.mipmaps = 1;
+    WorkerWithKerning *worker = arg;
+    worker->proc(worker->arg);
+    UnloadKernTextScratch();
 
-    return image;
+    return 0;
+}
+    #else
+static void *WorkerProcWithKerning(void *arg)
+{
+    WorkerWithKerning *worker = arg;
+    worker->proc(worker->arg);
+    UnloadKernTextScratch();
+
+    return NULL;
 }
+    #endif
+#endif
 
-FontWithKerning LoadFontWithKerning(const char *fileName, int baseFontSize)
+// start proc(arg) on a new thread - returns 0 if the thread could not be started
+static int StartWorkerWithKerning(WorkerWithKerning *worker, void (*proc)(void *), void *arg)
 {
-    return LoadFontWithKerningEx(fileName, baseFontSize, NULL, 0);
+    worker->proc = proc;
+    worker->arg = arg;
+#if defined(RLTEXTKERNER_NO_THREADS)
+    return 0;
+#elif defined(_WIN32)
+    worker->handle = CreateThread(NULL, 0, WorkerProcWithKerning, worker, 0, NULL);
+    return worker->handle != NULL;
+#else
+    return pthread_create(&worker->handle, NULL, WorkerProcWithKerning, worker) == 0;
+#endif
 }
 
-FontWithKerning LoadFontWithKerningEx(const char *fileName, int baseFontSize, const int *codepoints, int codepointCount)
+// wait for a started worker thread to finish
+static void JoinWorkerWithKerning(WorkerWithKerning *worker)
 {
-    FontWithKerning font = { 0 };
+#if defined(RLTEXTKERNER_NO_THREADS)
+    (void) worker;
+#elif defined(_WIN32)
+    WaitForSingleObject(worker->handle, 0xffffffff);
+    CloseHandle(worker->handle);
+#else
+    pthread_join(worker->handle, NULL);
+#endif
+}
 
-    if (!IsFileExtension(fileName, ".ttf") && !IsFileExtension(fileName, ".otf")) {
-        TraceLog(LOG_WARNING, "FONT: Error loading font (%s) with kerning - file must be either TTF or OTF.", fileName);
+#if defined(RLTEXTKERNER_NO_THREADS)
+typedef int MutexWithKerning;
+#elif defined(_WIN32)
+typedef struct MutexWithKerning { void *ptr; } MutexWithKerning; // SRWLOCK
+__declspec(dllimport) void __stdcall AcquireSRWLockExclusive(MutexWithKerning *lock);
+__declspec(dllimport) void __stdcall ReleaseSRWLockExclusive(MutexWithKerning *lock);
+#else
+typedef pthread_mutex_t MutexWithKerning;
+#endif
 
-        return font;
-    }
+// initializer for mutexes with static storage, which don't need InitMutexWithKerning
+#if defined(RLTEXTKERNER_NO_THREADS)
+    #define RLTEXTKERNER_MUTEX_INITIALIZER 0
+#elif defined(_WIN32)
+    #define RLTEXTKERNER_MUTEX_INITIALIZER { NULL }
+#else
+    #define RLTEXTKERNER_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
 
-    // Loading file to memory
-    int dataSize = 0;
-    unsigned char *fileData = LoadFileData(fileName, &dataSize);
+static void InitMutexWithKerning(MutexWithKerning *mutex)
+{
+#if defined(RLTEXTKERNER_NO_THREADS)
+    *mutex = 0;
+#elif defined(_WIN32)
+    mutex->ptr = NULL;
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
 
-    if (fileData == NULL) {
-        TraceLog(LOG_WARNING, "FONT: Error loading file %s", fileName);
+static void LockMutexWithKerning(MutexWithKerning *mutex)
+{
+#if defined(RLTEXTKERNER_NO_THREADS)
+    (void) mutex;
+#elif defined(_WIN32)
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
 
-        return font;
-    }
+static void UnlockMutexWithKerning(MutexWithKerning *mutex)
+{
+#if defined(RLTEXTKERNER_NO_THREADS)
+    (void) mutex;
+#elif defined(_WIN32)
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
 
-    return LoadFontWithKerningFromMemory(fileData, baseFontSize, dataSize, codepoints, codepointCount);
+static void DestroyMutexWithKerning(MutexWithKerning *mutex)
+{
+#if defined(RLTEXTKERNER_NO_THREADS) || defined(_WIN32)
+    (void) mutex;
+#else
+    pthread_mutex_destroy(mutex);
+#endif
 }
 
-FontWithKerning LoadFontWithKerningFromMemory(const unsigned char *fileData, int baseFontSize, int dataSize, const int *codepoints, int codepointCount)
+#if defined(RLTEXTKERNER_NO_THREADS)
+typedef int ConditionWithKerning;
+#elif defined(_WIN32)
+typedef struct ConditionWithKerning { void *ptr; } ConditionWithKerning; // CONDITION_VARIABLE
+__declspec(dllimport) int __stdcall SleepConditionVariableSRW(ConditionWithKerning *condition, MutexWithKerning *lock, unsigned long milliseconds, unsigned long flags);
+__declspec(dllimport) void __stdcall WakeAllConditionVariable(ConditionWithKerning *condition);
+#else
+typedef pthread_cond_t ConditionWithKerning;
+#endif
+
+static void InitConditionWithKerning(ConditionWithKerning *condition)
 {
-    FontWithKerning font = { 0 };
+#if defined(RLTEXTKERNER_NO_THREADS)
+    *condition = 0;
+#elif defined(_WIN32)
+    condition->ptr = NULL;
+#else
+    pthread_cond_init(condition, NULL);
+#endif
+}
 
-    font.info = RL_MALLOC(sizeof(*font.info));
-    if (font.info != NULL && stbtt_InitFont(font.info, fileData, 0)) {
-        TraceLog(LOG_INFO, "FONT: TTF font TTF info loaded successfully. Kerning enabled: %s", font.info->gpos || font.info->kern ? "true" : "false");
-        // load default glyphs
-        font.glyphCount = (codepointCount > 0) ? codepointCount : 95;
-        font.glyphs = RL_MALLOC(font.glyphCount * sizeof(*font.glyphs));
+// release mutex & wait for the condition to be signaled, then lock the mutex again
+static void WaitConditionWithKerning(ConditionWithKerning *condition, MutexWithKerning *mutex)
+{
+#if defined(RLTEXTKERNER_NO_THREADS)
+    (void) condition;
+    (void) mutex;
+#elif defined(_WIN32)
+    SleepConditionVariableSRW(condition, mutex, 0xffffffff, 0);
+#else
+    pthread_cond_wait(condition, mutex);
+#endif
+}
 
-        if (font.glyphs != NULL) {
-            for (int i=0; i < font.glyphCount; i++) {
-                int codepoint;
-                if (codepoints == NULL) codepoint = i + 32;
-                else codepoint = codepoints[i];
-                float fontScale = stbtt_ScaleForPixelHeight(font.info, baseFontSize);
-                GlyphWithKerning glyph = { 0 };
-                glyph.value = codepoint;
-                glyph.index = stbtt_FindGlyphIndex(font.info, codepoint);
-                stbtt_GetGlyphHMetrics(font.info, glyph.index, &glyph.advanceX, &glyph.lsb);
-                glyph.imageCount = 1;
-                glyph.images = RL_MALLOC(sizeof(*glyph.images));
-                glyph.images[0] = CreateGlyphImageWithKerning(font, codepoint, fontScale);
-                font.glyphs[i] = glyph;
-            }
-            TraceLog(LOG_INFO, "FONT: TTF font glyphs loaded successfully (%i glyphs)", font.glyphCount);
-        } else {
-            TraceLog(LOG_WARNING, "FONT: Error allocating memory for font glyphs");
-        }
-    } else {
-        TraceLog(LOG_WARNING, "FONT: Error loading TTF font info! Font unusable with kerning.");
-        if (font.info) free(font.info);
-        font.info = NULL;
-    }
+// wake all threads waiting for the condition
+static void SignalConditionWithKerning(ConditionWithKerning *condition)
+{
+#if defined(RLTEXTKERNER_NO_THREADS)
+    (void) condition;
+#elif defined(_WIN32)
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif
+}
 
-    return font;
+static void DestroyConditionWithKerning(ConditionWithKerning *condition)
+{
+#if defined(RLTEXTKERNER_NO_THREADS) || defined(_WIN32)
+    (void) condition;
+#else
+    pthread_cond_destroy(condition);
+#endif
 }
 
-void UpdateFontWithKerningBitmaps(FontWithKerning *font, int fontSize)
+// monotonic time in nanoseconds
+static unsigned long long GetNanosecondsWithKerning(void)
 {
-    float fontScale = stbtt_ScaleForPixelHeight(font->info, fontSize);
-    for (int i=0; i<font->glyphCount; i++) {
-        GlyphWithKerning *glyph = &font->glyphs[i];
-        ++glyph->imageCount;
-        Image *images = RL_REALLOC(glyph->images, glyph->imageCount * sizeof(*glyph->images));
-        if (images) {
-            glyph->images = images;
-            glyph->images[glyph->imageCount - 1] = CreateGlyphImageWithKerning(*font, glyph->value, fontScale);
-        } else {
-            TraceLog(LOG_WARNING, "FONT: Error updating font glyph memory!");
-        }
+#if defined(_WIN32)
+    long long count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (unsigned long long) (count / frequency) * 1000000000ULL + (unsigned long long) (count % frequency) * 1000000000ULL / frequency;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+// let other threads & processes run for about a millisecond
+static void SleepMillisecondWithKerning(void)
+{
+#if defined(_WIN32)
+    Sleep(1);
+#else
+    struct timespec duration = { 0, 1000000 };
+    nanosleep(&duration, NULL);
+#endif
+}
+
+// Trace ring buffer - writers claim a slot by incrementing the event count, so they never wait on each other. Each slot
+// has a sequence number that is 0 while an event is written & the event number + 1 once it's complete, so an export
+// running at the same time skips events that are being (over)written.
+
+// Define RLTEXTKERNER_TRACE to record KernTraceEvents - statements wrapped in this are removed otherwise
+#if defined(RLTEXTKERNER_TRACE)
+    #define RLTEXTKERNER_TRACE_SPAN(...) __VA_ARGS__
+#else
+    #define RLTEXTKERNER_TRACE_SPAN(...)
+#endif
+
+// number of events kept in the trace ring buffer (power of 2)
+#ifndef RLTEXTKERNER_TRACE_EVENTS
+    #define RLTEXTKERNER_TRACE_EVENTS 65536
+#endif
+
+#if defined(RLTEXTKERNER_TRACE)
+#include <stdio.h>
+
+typedef struct TraceSlotWithKerning {
+    atomic_ullong sequence;
+    KernTraceEvent event;
+} TraceSlotWithKerning;
+
+static TraceSlotWithKerning traceSlots[RLTEXTKERNER_TRACE_EVENTS];
+static atomic_ullong traceEventCount = 0;   // events recorded since the last clear
+static atomic_int traceThreadCount = 0;     // thread ids handed out
+static _Thread_local int traceThread = 0;   // id of this thread (0 until it records an event)
+static _Atomic(KernTraceCallback) traceCallback = NULL;
+static void *_Atomic traceUserData = NULL;
+
+static const char *traceSpanNames[] = { "LoadFont", "UpdateBitmaps", "Layout", "Rasterize", "Composite", "Frame" };
+
+// record a trace event, or pass it to the callback
+static void TraceWithKerning(int span, char phase, int textLength, int fontSize, int glyphCount, int cacheMisses)
+{
+    if (traceThread == 0) traceThread = atomic_fetch_add_explicit(&traceThreadCount, 1, memory_order_relaxed) + 1;
+    KernTraceEvent event = { span, phase, traceThread, GetNanosecondsWithKerning(), textLength, fontSize, glyphCount, cacheMisses };
+
+    KernTraceCallback callback = atomic_load_explicit(&traceCallback, memory_order_acquire);
+    if (callback != NULL) {
+        callback(&event, atomic_load_explicit(&traceUserData, memory_order_relaxed));
+        return;
     }
+
+    unsigned long long index = atomic_fetch_add_explicit(&traceEventCount, 1, memory_order_relaxed);
+    TraceSlotWithKerning *slot = &traceSlots[index & (RLTEXTKERNER_TRACE_EVENTS - 1)];
+    atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->event = event;
+    atomic_store_explicit(&slot->sequence, index + 1, memory_order_release);
 }
+#endif
 
-void UnloadFontWithKerning(FontWithKerning font)
+void SetKernTraceCallback(KernTraceCallback callback, void *userData)
 {
-    if (font.glyphs) {
-        for (int i=0; i<font.glyphCount; i++) {
-            for (int j=0; j<font.glyphs[i].imageCount; j++) {
-                UnloadImage(font.glyphs[i].images[j]);
-            }
-            free(font.glyphs[i].images);
-        }
-        free(font.glyphs);
+#if defined(RLTEXTKERNER_TRACE)
+    atomic_store_explicit(&traceUserData, userData, memory_order_relaxed);
+    atomic_store_explicit(&traceCallback, callback, memory_order_release);
+#else
+    (void) callback;
+    (void) userData;
+#endif
+}
+
+bool ExportKernTrace(const char *fileName)
+{
+#if defined(RLTEXTKERNER_TRACE)
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Unable to open trace file %s", fileName);
+        return false;
+    }
+
+    unsigned long long end = atomic_load_explicit(&traceEventCount, memory_order_acquire);
+    unsigned long long start = end > RLTEXTKERNER_TRACE_EVENTS ? end - RLTEXTKERNER_TRACE_EVENTS : 0;
+    int first = 1;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (unsigned long long i = start; i < end; i++) {
+        TraceSlotWithKerning *slot = &traceSlots[i & (RLTEXTKERNER_TRACE_EVENTS - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != i + 1) continue;
+        KernTraceEvent event = slot->event;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != i + 1) continue;
+
+        fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"rltextkerner\",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":1,\"tid\":%d,%s"
+                "\"args\":{\"textLength\":%d,\"fontSize\":%d,\"glyphCount\":%d,\"cacheMisses\":%d}}",
+                first ? "" : ",\n", traceSpanNames[event.span], event.phase, event.time / 1000, event.time % 1000, event.thread,
+                event.phase == 'i' ? "\"s\":\"p\"," : "", event.textLength, event.fontSize, event.glyphCount, event.cacheMisses);
+        first = 0;
     }
-    if (font.info->data) free(font.info->data);
-    if (font.info) free(font.info);
+    fprintf(file, "\n]}\n");
+
+    bool success = !ferror(file);
+    if (fclose(file) != 0) success = false;
+    if (!success) TraceLog(LOG_WARNING, "FONT: Error writing trace file %s", fileName);
+
+    return success;
+#else
+    (void) fileName;
+    TraceLog(LOG_WARNING, "FONT: Unable to export trace - compile with RLTEXTKERNER_TRACE defined to record traces");
+    return false;
+#endif
 }
 
-Image KernTextWrapped(const char *text, FontWithKerning font, int fontSize, int maxWidth)
+void ClearKernTrace(void)
 {
-    return KernTextEx(text, font, fontSize, maxWidth, GetScreenHeight(), 1, 1);
+#if defined(RLTEXTKERNER_TRACE)
+    atomic_store_explicit(&traceEventCount, 0, memory_order_relaxed);
+    for (int i = 0; i < RLTEXTKERNER_TRACE_EVENTS; i++) atomic_store_explicit(&traceSlots[i].sequence, 0, memory_order_relaxed);
+#endif
 }
 
-Image KernText(const char *text, FontWithKerning font, int fontSize)
+void MarkKernTraceFrame(void)
 {
-    return KernTextEx(text, font, fontSize, GetScreenWidth(), GetScreenHeight(), 0, 1);
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_FRAME, 'i', 0, 0, 0, 0));
 }
 
-Image KernTextEx(const char *text, FontWithKerning font, int fontSize, int maxWidth, int maxHeight, int wrap, int subpixel)
+unsigned long long GetKernTraceTime(void)
 {
-    int codepointsCount;
-    int *codepoints = LoadCodepoints(text, &codepointsCount);
-    Image result = KernCodepoints(codepoints, codepointsCount, font, fontSize, maxWidth, maxHeight, wrap, subpixel);
-    free(codepoints);
+    return GetNanosecondsWithKerning();
+}
 
-    return result;
+// get the number of threads to use for the requested thread count (<= 0 means one per CPU core)
+static int GetThreadCountWithKerning(int threadCount)
+{
+#if defined(RLTEXTKERNER_NO_THREADS)
+    return 1;
+#else
+    if (threadCount <= 0) {
+    #if defined(_WIN32)
+        threadCount = (int) GetActiveProcessorCount(0xffff);
+    #else
+        threadCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    }
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > RLTEXTKERNER_MAX_THREADS) threadCount = RLTEXTKERNER_MAX_THREADS;
+
+    return threadCount;
+#endif
 }
 
-int GetGlyphIndexWithKerning(FontWithKerning font, int codepoint)
+// run proc(arg) on threadCount threads (including the calling thread) and wait for all of them to finish
+static void RunWorkersWithKerning(int threadCount, void (*proc)(void *), void *arg)
 {
-    for (int i = 0; i < font.glyphCount; i++) {
-        if (font.glyphs[i].value == codepoint) {
-            return font.glyphs[i].index;
-        }
+    WorkerWithKerning workers[RLTEXTKERNER_MAX_THREADS];
+    int started = 0;
+
+    while (started + 1 < threadCount && started + 1 < RLTEXTKERNER_MAX_THREADS) {
+        if (!StartWorkerWithKerning(&workers[started], proc, arg)) break;
+        ++started;
     }
 
-    return stbtt_FindGlyphIndex(font.info, codepoint);
+    // the calling thread works too, so this still completes if no threads could be started
+    proc(arg);
+
+    for (int i = 0; i < started; i++) JoinWorkerWithKerning(&workers[i]);
 }
 
-// get glyph from font - index will be 0 if invalid
-GlyphWithKerning GetGlyphWithKerning(FontWithKerning font, int codepoint)
+// glyph bitmaps to rasterize - each job writes to its own preallocated image, so the result does not depend on the
+// order in which the worker threads pick up jobs
+typedef struct GlyphJobsWithKerning {
+    FontWithKerning font;
+    Image *images;           // images of each glyph, imageCount per glyph
+    int imageCount;
+    const float *fontScales; // font scale for each size
+    int fontScaleCount;      // number of sizes
+    int firstImage;          // index in the images of a glyph of the image for the first size
+    atomic_int nextJob;      // next job to be picked up by a worker
+} GlyphJobsWithKerning;
+
+Image CreateGlyphImageWithKerning(FontWithKerning font, int codepoint, float fontScale);
+
+static void RasterizeGlyphJobsWithKerning(void *arg)
 {
-    for (int i = 0; i < font.glyphCount; i++) {
-        if (font.glyphs[i].value == codepoint) {
-            return font.glyphs[i];
-        }
+    GlyphJobsWithKerning *jobs = arg;
+    int jobCount = jobs->font.glyphCount * jobs->fontScaleCount;
+    RLTEXTKERNER_TRACE_SPAN(int rasterized = 0);
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_RASTERIZE, 'B', 0, 0, 0, 0));
+
+    for (int job = atomic_fetch_add(&jobs->nextJob, 1); job < jobCount; job = atomic_fetch_add(&jobs->nextJob, 1)) {
+        int glyph = job % jobs->font.glyphCount;
+        int size = job / jobs->font.glyphCount;
+        jobs->images[glyph * jobs->imageCount + jobs->firstImage + size] = CreateGlyphImageWithKerning(jobs->font, jobs->font.codepoints[glyph], jobs->fontScales[size]);
+        RLTEXTKERNER_TRACE_SPAN(++rasterized);
     }
 
-    return (GlyphWithKerning){ 0 };
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_RASTERIZE, 'E', 0, 0, rasterized, 0));
 }
 
-Image KernCodepoints(const int *codepoints, int codepointsCount, FontWithKerning font, int fontSize, int maxWidth, int maxHeight, int wrap, int subpixel)
+// rasterize glyph images for each font scale into the images of each glyph from firstImage, using threadCount threads
+static void RasterizeGlyphsWithKerning(FontWithKerning font, Image *images, int imageCount, const float *fontScales, int fontScaleCount, int firstImage, int threadCount)
 {
-    assert(font.info);
-    assert(maxWidth > 0);
-    assert(maxHeight > 0);
+    GlyphJobsWithKerning jobs = { .font = font, .images = images, .imageCount = imageCount, .fontScales = fontScales,
+                                  .fontScaleCount = fontScaleCount, .firstImage = firstImage };
+    atomic_init(&jobs.nextJob, 0);
 
-    // bitmap for writing the resulting image data
-    char *bitmap = RL_CALLOC(maxWidth * maxHeight, sizeof(unsigned char));
+    // don't start threads that would only have a few glyphs each to work on
+    int jobCount = font.glyphCount * fontScaleCount;
+    threadCount = GetThreadCountWithKerning(threadCount);
+    if (threadCount > jobCount / 16) threadCount = jobCount / 16;
+    if (threadCount < 1) threadCount = 1;
 
-    // obtain font metrics
-    float fontScale = stbtt_ScaleForPixelHeight(font.info, fontSize);
-    int ascent, descent, lineGap, yInc;
-    stbtt_GetFontVMetrics(font.info, &ascent, &descent, &lineGap);
-    ascent = roundf(ascent * fontScale);
-    descent = roundf(descent * fontScale);
-    lineGap = roundf(lineGap * fontScale);
-    yInc = ascent - descent + lineGap;
+    RunWorkersWithKerning(threadCount, RasterizeGlyphJobsWithKerning, &jobs);
+}
 
-    float x = 0;
-    int y = 0;
+void SetFontWithKerningThreadCount(int threadCount)
+{
+    fontThreadCount = threadCount;
+}
+
+void SetKernRasterizer(int rasterizer)
+{
+    atomic_store_explicit(&glyphRasterizer, rasterizer, memory_order_relaxed);
+}
+
+// Font faces - the font file data & stb_truetype info, shared by all fonts loaded from the same data. Loading a font
+// looks the data up by its hash in a list of the loaded faces, so loading a file again (e.g. for another base size)
+// reuses the face instead of keeping another copy of the data.
+//
+// The cmap (codepoint to glyph index mapping) of a face is decoded once into pages of 256 glyph indices, so looking up
+// a glyph index takes two loads instead of a binary search. Pages without any glyphs all share page 0 (all zeros). The
+// horizontal metrics of every glyph are decoded once too, for glyphs that aren't in the font glyph arrays.
+#define RLTEXTKERNER_CMAP_PAGES (0x110000 >> 8)
+
+#define RLTEXTKERNER_OUTLINE_PAGE 256   // glyph outlines in each page of a face's outline table
+
+// glyph outline as parsed by stb_truetype from the glyf/CFF data, with the glyph box - kept so rasterizing the glyph at
+// another size or subpixel phase doesn't decode it again
+typedef struct GlyphOutlineWithKerning {
+    bool hasBox;                // false for glyphs without an outline (e.g. space)
+    int x0, y0, x1, y1;         // glyph box, unscaled
+    int vertexCount;
+    stbtt_vertex *vertices;     // points just past the outline
+} GlyphOutlineWithKerning;
+
+typedef struct GlyphOutlinePageWithKerning {
+    _Atomic(GlyphOutlineWithKerning *) outlines[RLTEXTKERNER_OUTLINE_PAGE];
+} GlyphOutlinePageWithKerning;
+
+// advance & left side bearing of a glyph, unscaled
+typedef struct GlyphHMetricsWithKerning {
+    unsigned short advance;
+    short lsb;
+} GlyphHMetricsWithKerning;
+
+typedef struct FontFaceWithKerning {
+    stbtt_fontinfo info;
+    unsigned char *data;
+    int dataSize;
+    unsigned short cmapPages[RLTEXTKERNER_CMAP_PAGES]; // page in cmap for each 256 codepoints
+    unsigned short *cmap;       // glyph index of each codepoint in the pages (NULL if the cmap format isn't supported)
+    unsigned long long *coverage; // bit for each codepoint in the pages that has a glyph, for probing fallback fonts
+    int cmapPageCount;
+    GlyphHMetricsWithKerning *hmetrics; // metrics by glyph index (NULL if it couldn't be allocated)
+    _Atomic(GlyphOutlinePageWithKerning *) *outlinePages; // outlines by glyph index, pages added as glyphs are rasterized
+    atomic_ullong outlineBytes;
+    unsigned long long hash;    // hash of the data (0 if the face isn't in the list, as its size is unknown)
+    int refs;                   // fonts using the face - only changed with facesLock held
+    struct FontFaceWithKerning *next;
+} FontFaceWithKerning;
+
+static FontFaceWithKerning *faces = NULL;
+static MutexWithKerning facesLock = RLTEXTKERNER_MUTEX_INITIALIZER;
+
+static unsigned long long HashFontDataWithKerning(const unsigned char *data, int dataSize)
+{
+    unsigned long long hash = 0xcbf29ce484222325ULL ^ (unsigned long long) dataSize;
     int i = 0;
-    int lastSpaceX = 0;
-    int lastSpaceIndex = 0;
-    int imageWidth = 0;
-    while (i < codepointsCount && y + yInc < maxHeight)
-    {
-        int codepoint = codepoints[i];
+    for (; i + 8 <= dataSize; i += 8) {
+        unsigned long long word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    for (; i < dataSize; i++) hash = (hash ^ data[i]) * 0x100000001b3ULL;
 
-        // lookup glyph indices, fallback to looking up the glyph within the font info
-        GlyphWithKerning glyph = GetGlyphWithKerning(font, codepoint);
-        if (glyph.index == 0) {
-            TraceLog(LOG_WARNING, "FONT: Unable to find glyph for codepoint %d", codepoint);
-            GlyphWithKerning glyph = { 0 };
-            glyph.value = codepoint;
-            glyph.index = stbtt_FindGlyphIndex(font.info, codepoint);
-            stbtt_GetGlyphHMetrics(font.info, glyph.index, &glyph.advanceX, &glyph.lsb);
-        }
+    return hash != 0 ? hash : 1;
+}
 
-        // handle newline characters
-        if (codepoint == '\n') {
-            // new line - first reset x to first column and advance y
-            lastSpaceX = 0;
-            lastSpaceIndex = 0;
-            x = 0;
-            y += yInc;
-        // mark word seen in current x pos
-        } else if (codepoint == ' ' || codepoint == '\t') {
-            lastSpaceX = x;
-            lastSpaceIndex = i;
-            if (x < maxWidth) x += glyph.advanceX * fontScale; // conditional to prevent overflow
-        // draw the glyph and handle word wrapping
-        } else {
-            // add kerning & calculate x increment for this glyph
-            int kern = 0;
-            if (i < codepointsCount - 1) {
-                // lookup kerning if two characters side by side
-                int glyphNextIndex = GetGlyphIndexWithKerning(font, codepoints[i + 1]);
-                kern = stbtt_GetGlyphKernAdvance(font.info, glyph.index, glyphNextIndex);
-            }
-            float xInc = kern * fontScale + glyph.advanceX * fontScale;
+// set the glyph index for a codepoint in the face cmap - until the pages are allocated, this marks the pages in use
+static void SetCmapGlyphWithKerning(FontFaceWithKerning *face, unsigned int codepoint, unsigned int glyphIndex)
+{
+    if (codepoint >= 0x110000 || glyphIndex == 0 || glyphIndex > 0xffff) return;
+    if (face->cmap == NULL) face->cmapPages[codepoint >> 8] = 1;
+    else face->cmap[face->cmapPages[codepoint >> 8] << 8 | (codepoint & 0xff)] = (unsigned short) glyphIndex;
+}
 
-            // handle word wrap
+// set the glyph index of every codepoint mapped by the font's cmap, with the same results as stbtt_FindGlyphIndex -
+// returns false if the cmap format isn't supported
+static bool DecodeCmapWithKerning(FontFaceWithKerning *face)
+{
+    unsigned char *data = face->info.data;
+    unsigned int map = face->info.index_map;
+    int format = ttUSHORT(data + map);
+
+    if (format == 0) {
+        int bytes = ttUSHORT(data + map + 2);
+        for (int c = 0; c < bytes - 6 && c < 256; c++) SetCmapGlyphWithKerning(face, c, ttBYTE(data + map + 6 + c));
+    } else if (format == 6) {
+        unsigned int first = ttUSHORT(data + map + 6);
+        unsigned int count = ttUSHORT(data + map + 8);
+        for (unsigned int i = 0; i < count; i++) SetCmapGlyphWithKerning(face, first + i, ttUSHORT(data + map + 10 + i * 2));
+    } else if (format == 4) {
+        unsigned int segCount = ttUSHORT(data + map + 6) >> 1;
+        for (unsigned int i = 0; i < segCount; i++) {
+            unsigned int end = ttUSHORT(data + map + 14 + 2 * i);
+            unsigned int start = ttUSHORT(data + map + 14 + segCount * 2 + 2 + 2 * i);
+            int delta = ttSHORT(data + map + 14 + segCount * 4 + 2 + 2 * i);
+            unsigned int offset = ttUSHORT(data + map + 14 + segCount * 6 + 2 + 2 * i);
+            for (unsigned int c = start; c <= end; c++) {
+                // like stb_truetype, glyph indices read through the range offset don't get the delta added
+                unsigned int glyphIndex = offset == 0 ? (c + delta) & 0xffff
+                                                      : ttUSHORT(data + offset + (c - start) * 2 + map + 14 + segCount * 6 + 2 + 2 * i);
+                SetCmapGlyphWithKerning(face, c, glyphIndex);
+            }
+        }
+    } else if (format == 12 || format == 13) {
+        unsigned int groupCount = ttULONG(data + map + 12);
+        for (unsigned int i = 0; i < groupCount; i++) {
+            unsigned int start = ttULONG(data + map + 16 + i * 12);
+            unsigned int end = ttULONG(data + map + 16 + i * 12 + 4);
+            unsigned int startGlyph = ttULONG(data + map + 16 + i * 12 + 8);
+            for (unsigned int c = start; c <= end && c < 0x110000; c++) {
+                SetCmapGlyphWithKerning(face, c, format == 12 ? startGlyph + (c - start) : startGlyph);
+            }
+        }
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+// decode the face cmap into pages - without them, glyph indices are looked up with stbtt_FindGlyphIndex
+static void LoadCmapWithKerning(FontFaceWithKerning *face)
+{
+    if (!DecodeCmapWithKerning(face)) return;
+
+    // number the pages marked by the first pass, then fill them in
+    face->cmapPageCount = 1;
+    for (int i = 0; i < RLTEXTKERNER_CMAP_PAGES; i++) {
+        if (face->cmapPages[i] != 0) face->cmapPages[i] = (unsigned short) face->cmapPageCount++;
+    }
+    face->cmap = RL_CALLOC(face->cmapPageCount << 8, sizeof(*face->cmap));
+    if (face->cmap == NULL) {
+        memset(face->cmapPages, 0, sizeof(face->cmapPages));
+        face->cmapPageCount = 0;
+        return;
+    }
+    DecodeCmapWithKerning(face);
+
+    face->coverage = RL_CALLOC(face->cmapPageCount << 2, sizeof(*face->coverage));
+    for (int i = 0; face->coverage != NULL && i < face->cmapPageCount << 8; i++) {
+        if (face->cmap[i] != 0) face->coverage[i >> 6] |= 1ULL << (i & 63);
+    }
+}
+
+// get the glyph index for a codepoint (0 if the font has no glyph for it)
+static inline int FindFaceGlyphWithKerning(const FontFaceWithKerning *face, int codepoint)
+{
+    if (face->cmap == NULL) return stbtt_FindGlyphIndex(&face->info, codepoint);
+    if ((unsigned int) codepoint >= 0x110000) return 0;
+
+    return face->cmap[face->cmapPages[codepoint >> 8] << 8 | (codepoint & 0xff)];
+}
+
+// check if the face has a glyph for a codepoint, touching less memory than getting the glyph index
+static inline bool HasFaceGlyphWithKerning(const FontFaceWithKerning *face, int codepoint)
+{
+    if (face->coverage == NULL) return FindFaceGlyphWithKerning(face, codepoint) != 0;
+    if ((unsigned int) codepoint >= 0x110000) return false;
+
+    int bit = face->cmapPages[codepoint >> 8] << 8 | (codepoint & 0xff);
+    return (face->coverage[bit >> 6] >> (bit & 63)) & 1;
+}
+
+// decode the advance & left side bearing of every glyph in the face
+static void LoadHMetricsWithKerning(FontFaceWithKerning *face)
+{
+    face->hmetrics = RL_MALLOC(face->info.numGlyphs * sizeof(*face->hmetrics));
+    for (int i = 0; face->hmetrics != NULL && i < face->info.numGlyphs; i++) {
+        int advance, lsb;
+        stbtt_GetGlyphHMetrics(&face->info, i, &advance, &lsb);
+        face->hmetrics[i] = (GlyphHMetricsWithKerning){ (unsigned short) advance, (short) lsb };
+    }
+}
+
+// get the advance & left side bearing of a glyph, unscaled
+static inline void GetFaceHMetricsWithKerning(const FontFaceWithKerning *face, int glyphIndex, int *advance, int *lsb)
+{
+    if (face->hmetrics == NULL || glyphIndex >= face->info.numGlyphs) {
+        stbtt_GetGlyphHMetrics(&face->info, glyphIndex, advance, lsb);
+        return;
+    }
+    *advance = face->hmetrics[glyphIndex].advance;
+    *lsb = face->hmetrics[glyphIndex].lsb;
+}
+
+// free a face with its tables & the font file data
+static void FreeFontFaceWithKerning(FontFaceWithKerning *face)
+{
+    int pageCount = (face->info.numGlyphs + RLTEXTKERNER_OUTLINE_PAGE - 1) / RLTEXTKERNER_OUTLINE_PAGE;
+    for (int i = 0; face->outlinePages != NULL && i < pageCount; i++) {
+        GlyphOutlinePageWithKerning *page = atomic_load_explicit(&face->outlinePages[i], memory_order_relaxed);
+        for (int j = 0; page != NULL && j < RLTEXTKERNER_OUTLINE_PAGE; j++) {
+            RL_FREE(atomic_load_explicit(&page->outlines[j], memory_order_relaxed));
+        }
+        RL_FREE(page);
+    }
+    RL_FREE(face->outlinePages);
+    RL_FREE(face->cmap);
+    RL_FREE(face->coverage);
+    RL_FREE(face->hmetrics);
+    RL_FREE(face->data);
+    RL_FREE(face);
+}
+
+// find a loaded face with the same font file data, adding a font to its users - facesLock must be held
+static FontFaceWithKerning *ShareFontFaceWithKerning(const unsigned char *fileData, int dataSize, unsigned long long hash)
+{
+    for (FontFaceWithKerning *face = faces; face != NULL && hash != 0; face = face->next) {
+        if (face->hash == hash && face->dataSize == dataSize && memcmp(face->data, fileData, dataSize) == 0) {
+            ++face->refs;
+            return face;
+        }
+    }
+
+    return NULL;
+}
+
+// get the face for the font file data, taking ownership of the data - returns NULL if the data isn't a valid font
+static FontFaceWithKerning *LoadFontFaceWithKerning(const unsigned char *fileData, int dataSize)
+{
+    unsigned long long hash = dataSize > 0 ? HashFontDataWithKerning(fileData, dataSize) : 0;
+
+    LockMutexWithKerning(&facesLock);
+    FontFaceWithKerning *shared = ShareFontFaceWithKerning(fileData, dataSize, hash);
+    UnlockMutexWithKerning(&facesLock);
+    if (shared != NULL) {
+        if (fileData != shared->data) RL_FREE((void *) fileData);
+        TraceLog(LOG_INFO, "FONT: TTF font data shared with an already loaded font");
+        return shared;
+    }
+
+    // new face - decoded without the lock held, then looked up again in case another thread added the same data meanwhile
+    FontFaceWithKerning *face = RL_CALLOC(1, sizeof(*face));
+    if (face == NULL || !stbtt_InitFont(&face->info, fileData, 0)) {
+        RL_FREE(face);
+        return NULL;
+    }
+    face->data = (unsigned char *) fileData;
+    face->dataSize = dataSize;
+    face->hash = hash;
+    face->refs = 1;
+    LoadCmapWithKerning(face);
+    LoadHMetricsWithKerning(face);
+    face->outlinePages = RL_CALLOC((face->info.numGlyphs + RLTEXTKERNER_OUTLINE_PAGE - 1) / RLTEXTKERNER_OUTLINE_PAGE, sizeof(*face->outlinePages));
+
+    if (hash != 0) {
+        LockMutexWithKerning(&facesLock);
+        shared = ShareFontFaceWithKerning(fileData, dataSize, hash);
+        if (shared == NULL) {
+            face->next = faces;
+            faces = face;
+        }
+        UnlockMutexWithKerning(&facesLock);
+        if (shared != NULL) {
+            FreeFontFaceWithKerning(face);
+            TraceLog(LOG_INFO, "FONT: TTF font data shared with an already loaded font");
+            return shared;
+        }
+    }
+
+    return face;
+}
+
+// release a font's use of the face, freeing it & the font file data after the last font
+static void UnloadFontFaceWithKerning(FontFaceWithKerning *face)
+{
+    if (face == NULL) return;
+
+    LockMutexWithKerning(&facesLock);
+    bool unused = --face->refs == 0;
+    if (unused) {
+        FontFaceWithKerning **link = &faces;
+        while (*link != NULL && *link != face) link = &(*link)->next;
+        if (*link != NULL) *link = face->next;
+    }
+    UnlockMutexWithKerning(&facesLock);
+
+    if (unused) FreeFontFaceWithKerning(face);
+}
+
+// get the outline of a glyph, decoding it the first time it is rasterized (NULL if it can't be allocated) - outlines are
+// added without locks, so threads rasterizing the same new glyph may both decode it, & are only freed with the face
+static const GlyphOutlineWithKerning *GetGlyphOutlineWithKerning(FontFaceWithKerning *face, int glyphIndex)
+{
+    if (face->outlinePages == NULL || glyphIndex < 0 || glyphIndex >= face->info.numGlyphs) return NULL;
+
+    _Atomic(GlyphOutlinePageWithKerning *) *pageSlot = &face->outlinePages[glyphIndex / RLTEXTKERNER_OUTLINE_PAGE];
+    GlyphOutlinePageWithKerning *page = atomic_load_explicit(pageSlot, memory_order_acquire);
+    if (page == NULL) {
+        GlyphOutlinePageWithKerning *added = RL_CALLOC(1, sizeof(*added));
+        if (added == NULL) return NULL;
+        if (atomic_compare_exchange_strong_explicit(pageSlot, &page, added, memory_order_acq_rel, memory_order_acquire)) {
+            page = added;
+            atomic_fetch_add_explicit(&face->outlineBytes, sizeof(*added), memory_order_relaxed);
+        } else {
+            RL_FREE(added);
+        }
+    }
+
+    _Atomic(GlyphOutlineWithKerning *) *slot = &page->outlines[glyphIndex % RLTEXTKERNER_OUTLINE_PAGE];
+    GlyphOutlineWithKerning *outline = atomic_load_explicit(slot, memory_order_acquire);
+    if (outline != NULL) return outline;
+
+    stbtt_vertex *vertices = NULL;
+    int vertexCount = stbtt_GetGlyphShape(&face->info, glyphIndex, &vertices);
+    size_t size = sizeof(*outline) + vertexCount * sizeof(*vertices);
+    GlyphOutlineWithKerning *added = RL_MALLOC(size);
+    if (added != NULL) {
+        added->x0 = added->y0 = added->x1 = added->y1 = 0;
+        added->hasBox = stbtt_GetGlyphBox(&face->info, glyphIndex, &added->x0, &added->y0, &added->x1, &added->y1) != 0;
+        added->vertexCount = vertexCount;
+        added->vertices = (stbtt_vertex *) (added + 1);
+        if (vertexCount > 0) memcpy(added->vertices, vertices, vertexCount * sizeof(*vertices));
+    }
+    stbtt_FreeShape(&face->info, vertices);
+    if (added == NULL) return NULL;
+
+    if (atomic_compare_exchange_strong_explicit(slot, &outline, added, memory_order_acq_rel, memory_order_acquire)) {
+        atomic_fetch_add_explicit(&face->outlineBytes, size, memory_order_relaxed);
+        return added;
+    }
+    RL_FREE(added); // another thread added the outline first
+
+    return outline;
+}
+
+// get the bitmap box of a glyph outline at a scale & horizontal shift, like stbtt_GetGlyphBitmapBoxSubpixel
+static void GetGlyphOutlineBoxWithKerning(const GlyphOutlineWithKerning *outline, float scale, float shiftX, int *x0, int *y0, int *x1, int *y1)
+{
+    if (!outline->hasBox) {
+        *x0 = *y0 = *x1 = *y1 = 0;
+        return;
+    }
+    *x0 = (int) floorf(outline->x0 * scale + shiftX);
+    *y0 = (int) floorf(-outline->y1 * scale);
+    *x1 = (int) ceilf(outline->x1 * scale + shiftX);
+    *y1 = (int) ceilf(-outline->y0 * scale);
+}
+
+// Accumulation rasterizer - each edge of the outline adds the signed area it covers in each pixel to a buffer, & a
+// running sum over the buffer then gives the coverage of each pixel (as in font-rs). Unlike stb_truetype's rasterizer,
+// no edge list is sorted or kept active, & the sum is done 4 pixels at a time with SSE2.
+
+// add the signed area covered by a line (in bitmap pixels, y down) to the accumulation buffer - areas past the right of
+// a row land at the start of the next row, which the running sum carries over from the end of the row anyway
+static void AccumulateLineWithKerning(float *accumulation, int width, int height, float x0, float y0, float x1, float y1)
+{
+    if (y0 == y1) return;
+    float direction = 1;
+    if (y0 > y1) {
+        float x = x0, y = y0;
+        x0 = x1, y0 = y1, x1 = x, y1 = y;
+        direction = -1;
+    }
+
+    float dxdy = (x1 - x0) / (y1 - y0);
+    float x = y0 < 0 ? x0 - y0 * dxdy : x0;
+    int rowEnd = y1 < height ? (int) ceilf(y1) : height;
+    for (int y = y0 > 0 ? (int) y0 : 0; y < rowEnd; y++) {
+        float *row = accumulation + y * width;
+        float dy = (y + 1 < y1 ? y + 1 : y1) - (y > y0 ? y : y0);
+        float xNext = x + dxdy * dy;
+        float d = dy * direction;
+
+        // the x range the line crosses in this row, kept inside the bitmap
+        float xa = x < xNext ? x : xNext;
+        float xb = x < xNext ? xNext : x;
+        xa = xa < 0 ? 0 : (xa > width ? width : xa);
+        xb = xb < 0 ? 0 : (xb > width ? width : xb);
+        float xaFloor = floorf(xa);
+        float xbCeil = ceilf(xb);
+        int xai = (int) xaFloor;
+        int xbi = (int) xbCeil;
+        if (xbi <= xai + 1) {
+            // within one pixel - split the area at the middle of the line
+            float xm = 0.5f * (xa + xb) - xaFloor;
+            row[xai] += d - d * xm;
+            row[xai + 1] += d * xm;
+        } else {
+            // across pixels - triangles at the ends, the same area in every pixel between them
+            float s = 1 / (xb - xa);
+            float xaFraction = xa - xaFloor;
+            float aStart = 0.5f * s * (1 - xaFraction) * (1 - xaFraction);
+            float xbFraction = xb - xbCeil + 1;
+            float aEnd = 0.5f * s * xbFraction * xbFraction;
+            row[xai] += d * aStart;
+            if (xbi == xai + 2) {
+                row[xai + 1] += d * (1 - aStart - aEnd);
+            } else {
+                float a1 = s * (1.5f - xaFraction);
+                row[xai + 1] += d * (a1 - aStart);
+                for (int xi = xai + 2; xi < xbi - 1; xi++) row[xi] += d * s;
+                float a2 = a1 + (xbi - xai - 3) * s;
+                row[xbi - 1] += d * (1 - a2 - aEnd);
+            }
+            row[xbi] += d * aEnd;
+        }
+        x = xNext;
+    }
+}
+
+// turn the accumulated areas into coverage values (rounded like stb_truetype does)
+static void AccumulateCoverageWithKerning(const float *accumulation, unsigned char *data, int count)
+{
+    int i = 0;
+    float sum = 0;
+#if defined(RLTEXTKERNER_SSE2)
+    // prefix sum of 4 areas in two shifted adds, plus the sum carried over from the previous 4
+    __m128 carry = _mm_setzero_ps();
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 max = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(accumulation + i);
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+        x = _mm_add_ps(x, carry);
+        __m128 coverage = _mm_min_ps(_mm_andnot_ps(sign, x), one);
+        __m128i values = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, max), half));
+        values = _mm_packs_epi32(values, values);
+        values = _mm_packus_epi16(values, values);
+        int packed = _mm_cvtsi128_si32(values);
+        memcpy(data + i, &packed, 4);
+        carry = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    sum = _mm_cvtss_f32(carry);
+#endif
+    for (; i < count; i++) {
+        sum += accumulation[i];
+        float coverage = fabsf(sum) < 1 ? fabsf(sum) : 1;
+        data[i] = (unsigned char) (coverage * 255 + 0.5f);
+    }
+}
+
+// accumulate a quadratic curve as lines, halving it until each line is within 0.35 pixels of the curve - the same lines
+// stb_truetype flattens curves into, so the coverage matches its bitmaps
+static void AccumulateCurveWithKerning(float *accumulation, int width, int height, float x0, float y0, float x1, float y1, float x2, float y2, int depth)
+{
+    float mx = (x0 + 2 * x1 + x2) / 4, my = (y0 + 2 * y1 + y2) / 4;
+    float dx = (x0 + x2) / 2 - mx, dy = (y0 + y2) / 2 - my;
+    if (depth < 16 && dx * dx + dy * dy > 0.35f * 0.35f) {
+        AccumulateCurveWithKerning(accumulation, width, height, x0, y0, (x0 + x1) / 2, (y0 + y1) / 2, mx, my, depth + 1);
+        AccumulateCurveWithKerning(accumulation, width, height, mx, my, (x1 + x2) / 2, (y1 + y2) / 2, x2, y2, depth + 1);
+    } else {
+        AccumulateLineWithKerning(accumulation, width, height, x0, y0, x2, y2);
+    }
+}
+
+// accumulate a cubic curve (CFF fonts) as lines, halving it like stb_truetype does
+static void AccumulateCubicWithKerning(float *accumulation, int width, int height, float x0, float y0, float x1, float y1, float x2, float y2, float x3, float y3, int depth)
+{
+    float dx0 = x1 - x0, dy0 = y1 - y0, dx1 = x2 - x1, dy1 = y2 - y1, dx2 = x3 - x2, dy2 = y3 - y2, dx = x3 - x0, dy = y3 - y0;
+    float longLength = sqrtf(dx0 * dx0 + dy0 * dy0) + sqrtf(dx1 * dx1 + dy1 * dy1) + sqrtf(dx2 * dx2 + dy2 * dy2);
+    float shortLength = sqrtf(dx * dx + dy * dy);
+    if (depth < 16 && longLength * longLength - shortLength * shortLength > 0.35f * 0.35f) {
+        float x01 = (x0 + x1) / 2, y01 = (y0 + y1) / 2, x12 = (x1 + x2) / 2, y12 = (y1 + y2) / 2, x23 = (x2 + x3) / 2, y23 = (y2 + y3) / 2;
+        float xa = (x01 + x12) / 2, ya = (y01 + y12) / 2, xb = (x12 + x23) / 2, yb = (y12 + y23) / 2;
+        float mx = (xa + xb) / 2, my = (ya + yb) / 2;
+        AccumulateCubicWithKerning(accumulation, width, height, x0, y0, x01, y01, xa, ya, mx, my, depth + 1);
+        AccumulateCubicWithKerning(accumulation, width, height, mx, my, xb, yb, x23, y23, x3, y3, depth + 1);
+    } else {
+        AccumulateLineWithKerning(accumulation, width, height, x0, y0, x3, y3);
+    }
+}
+
+// rasterize a glyph outline with the accumulation rasterizer
+static void AccumulateGlyphOutlineWithKerning(const GlyphOutlineWithKerning *outline, unsigned char *data, int width, int height, float scale, float shiftX, int x0, int y0)
+{
+    // areas right of the last row land past its end, so the buffer has a few floats to spare
+    float *accumulation = STBTT_malloc((width * height + 4) * sizeof(float), NULL);
+    if (accumulation == NULL) return;
+    memset(accumulation, 0, (width * height + 4) * sizeof(float));
+
+    float offsetX = shiftX - x0;
+    float offsetY = (float) -y0;
+    float startX = 0, startY = 0, lastX = 0, lastY = 0;
+    for (int i = 0; i < outline->vertexCount; i++) {
+        const stbtt_vertex *vertex = &outline->vertices[i];
+        float x = vertex->x * scale + offsetX;
+        float y = -vertex->y * scale + offsetY;
+        float cx = vertex->cx * scale + offsetX;
+        float cy = -vertex->cy * scale + offsetY;
+        if (vertex->type == STBTT_vmove) {
+            AccumulateLineWithKerning(accumulation, width, height, lastX, lastY, startX, startY); // close the last contour
+            startX = x, startY = y;
+        } else if (vertex->type == STBTT_vline) {
+            AccumulateLineWithKerning(accumulation, width, height, lastX, lastY, x, y);
+        } else if (vertex->type == STBTT_vcurve) {
+            AccumulateCurveWithKerning(accumulation, width, height, lastX, lastY, cx, cy, x, y, 0);
+        } else if (vertex->type == STBTT_vcubic) {
+            float cx1 = vertex->cx1 * scale + offsetX;
+            float cy1 = -vertex->cy1 * scale + offsetY;
+            AccumulateCubicWithKerning(accumulation, width, height, lastX, lastY, cx, cy, cx1, cy1, x, y, 0);
+        }
+        lastX = x, lastY = y;
+    }
+    AccumulateLineWithKerning(accumulation, width, height, lastX, lastY, startX, startY);
+
+    AccumulateCoverageWithKerning(accumulation, data, width * height);
+    STBTT_free(accumulation, NULL);
+}
+
+// rasterize a glyph outline into a bitmap the size of its box (x0, y0 from GetGlyphOutlineBoxWithKerning), like
+// stbtt_MakeGlyphBitmapSubpixel
+static void RasterizeGlyphOutlineWithKerning(const GlyphOutlineWithKerning *outline, unsigned char *data, int width, int height, float scale, float shiftX, int x0, int y0)
+{
+    if (atomic_load_explicit(&glyphRasterizer, memory_order_relaxed) == KERN_RASTERIZER_ACCUMULATE) {
+        AccumulateGlyphOutlineWithKerning(outline, data, width, height, scale, shiftX, x0, y0);
+        return;
+    }
+    stbtt__bitmap bitmap = { width, height, width, data };
+    stbtt_Rasterize(&bitmap, 0.35f, outline->vertices, outline->vertexCount, scale, scale, shiftX, 0, x0, y0, 1, NULL);
+}
+
+// Glyph cache - each shard is an open addressing hash table of pointers to cached glyphs. Readers only do atomic loads,
+// so lookups never wait on a lock. Writers lock the shard, and when the table is full they publish a new table - the
+// old table stays valid for readers still probing it.
+//
+// With a cache limit, glyphs are evicted (clock algorithm) while other threads may still be reading them. An evicted
+// glyph's slot is replaced with a tombstone & the glyph is retired instead of freed, like replaced tables. Readers count
+// themselves in one of two counters, picked by the parity of the cache epoch. The epoch only advances when no reader is
+// left in the previous epoch, so anything retired in epoch E can be freed once the epoch reaches E + 2. Without a limit
+// nothing is evicted, readers skip the counters & replaced tables are kept until the font is trimmed or unloaded.
+//
+// Glyphs are allocated from slabs of fixed size blocks in each shard, so evicted glyphs' memory is reused for new ones.
+
+#define RLTEXTKERNER_SLAB_CLASSES 7     // block sizes 64, 128 ... 4096 bytes - larger glyphs are allocated on their own
+#define RLTEXTKERNER_SLAB_SIZE 16384    // most bytes of blocks in a slab - slabs start at 4 blocks & double from there
+
+// glyph bitmap rendered for one glyph, font size & subpixel phase - the bitmap is never modified once in the cache
+typedef struct CachedGlyphWithKerning {
+    unsigned long long key; // glyph index, font size & subpixel phase
+    int width;              // bitmap width
+    int height;             // bitmap height
+    int offsetY;            // offset from the baseline to the top of the bitmap
+    int slabClass;          // block size the glyph was allocated from (-1 = allocated on its own)
+    atomic_bool referenced; // set when the glyph is used, cleared as the eviction clock hand passes it
+    atomic_int pins;        // PinFontWithKerningText calls keeping the glyph from being evicted
+    unsigned char *data;    // bitmap data, either stored after this struct or pre-rendered in the font glyph images
+    unsigned long long retiredEpoch;            // epoch the glyph was evicted in
+    struct CachedGlyphWithKerning *nextRetired; // glyph evicted before this one
+} CachedGlyphWithKerning;
+
+// marks the slot of an evicted glyph - its key matches no glyph, so readers just keep probing
+static CachedGlyphWithKerning glyphTombstone = { .key = ~0ULL };
+
+typedef struct GlyphTableWithKerning {
+    struct GlyphTableWithKerning *previous;      // replaced tables not yet freed (newest first)
+    unsigned long long retiredEpoch;             // epoch the table was replaced in
+    int capacity;                                // number of slots (power of 2)
+    _Atomic(CachedGlyphWithKerning *) slots[];
+} GlyphTableWithKerning;
+
+typedef struct GlyphSlabWithKerning {
+    struct GlyphSlabWithKerning *next;
+    size_t size;            // bytes of blocks
+    long long blocks[];
+} GlyphSlabWithKerning;
+
+typedef struct GlyphCacheShardWithKerning {
+    _Atomic(GlyphTableWithKerning *) table;
+    int count;              // number of glyphs in the table
+    int tombstones;         // number of evicted glyph slots in the table
+    int hand;               // slot the eviction clock hand is at
+    size_t bytes;           // memory used by the glyphs in the table
+    CachedGlyphWithKerning *retired;             // evicted glyphs not yet freed (newest first)
+    void *freeBlocks[RLTEXTKERNER_SLAB_CLASSES]; // free blocks of each size, linked through their first bytes
+    int slabBlocks[RLTEXTKERNER_SLAB_CLASSES];   // blocks of each size in the slabs
+    GlyphSlabWithKerning *slabs;
+    MutexWithKerning lock;  // held when allocating, adding, pinning or evicting glyphs
+} GlyphCacheShardWithKerning;
+
+#define RLTEXTKERNER_STAT_COUNT (int) (sizeof(FontWithKerningStats) / sizeof(unsigned long long))
+
+#define RLTEXTKERNER_SIZE_UNITS 64   // font sizes of cached glyphs are kept in 1/64 pixels, up to 2^24 units
+
+// font size kerned with or pre-rendered, for finding the sizes used least recently
+typedef struct FontSizeWithKerning {
+    int fontSize;           // in RLTEXTKERNER_SIZE_UNITS - set before the size is published by incrementing sizeCount
+    atomic_ullong lastUse;  // value of useClock when the size was last used
+} FontSizeWithKerning;
+
+#define RLTEXTKERNER_SDF_PADDING 4          // pixels of distance field around each glyph in the SDF atlas
+#define RLTEXTKERNER_SDF_ON_EDGE 128        // distance field value on the glyph outline (higher inside)
+#define RLTEXTKERNER_SDF_PIXEL_DISTANCE 32  // distance field steps per pixel away from the outline
+
+typedef struct SdfAtlasWithKerning {
+    Image image;            // distance fields of the font glyphs
+    int fontSize;           // font size the distance fields were rendered at
+    float fontScale;
+    int *rects;             // x, y, width, height & offset x, y (from the glyph origin) of each font glyph's distance field
+} SdfAtlasWithKerning;
+
+#define RLTEXTKERNER_DISK_CACHE_VERSION 1
+
+// start of a disk cache file, followed by its glyphs sorted by key & then their bitmaps
+typedef struct DiskCacheHeaderWithKerning {
+    char magic[4];                  // "RLKC"
+    unsigned int version;           // RLTEXTKERNER_DISK_CACHE_VERSION
+    unsigned long long fontHash;    // hash of the font data the glyphs were rendered from
+    int glyphSize;                  // in RLTEXTKERNER_SIZE_UNITS
+    int phases;                     // RLTEXTKERNER_SUBPIXEL_PHASES
+    int source;                     // KernRasterizer the glyphs were rendered with (-font size of the SDF atlas if drawn from it)
+    int glyphCount;
+} DiskCacheHeaderWithKerning;
+
+typedef struct DiskCacheGlyphWithKerning {
+    unsigned int key;               // glyph index << 8 | subpixel phase
+    unsigned short width;
+    unsigned short height;
+    int offsetY;
+    unsigned int offset;            // bitmap position in the file
+} DiskCacheGlyphWithKerning;
+
+// disk cache file for a glyph size, mapped into memory (NULL data if there is no valid file)
+typedef struct DiskCacheFileWithKerning {
+    int glyphSize;                  // set before the file is published by incrementing diskFileCount
+    const unsigned char *data;
+    size_t size;
+    unsigned int *savedKeys;        // keys of the glyphs this process last saved for the size, in order (held with diskLock)
+    int savedCount;
+} DiskCacheFileWithKerning;
+
+// map a whole file into memory read-only, returns NULL if it can't be opened or is empty
+static const unsigned char *MapFileWithKerning(const char *fileName, size_t *size)
+{
+#if defined(_WIN32)
+    void *file = CreateFileA(fileName, 0x80000000 /* GENERIC_READ */, 1 /* FILE_SHARE_READ */, NULL, 3 /* OPEN_EXISTING */, 0x80 /* FILE_ATTRIBUTE_NORMAL */, NULL);
+    if (file == (void *) -1) return NULL;
+    long long fileSize = 0;
+    void *mapping = GetFileSizeEx(file, &fileSize) && fileSize > 0 ? CreateFileMappingA(file, NULL, 2 /* PAGE_READONLY */, 0, 0, NULL) : NULL;
+    const unsigned char *data = mapping != NULL ? MapViewOfFile(mapping, 4 /* FILE_MAP_READ */, 0, 0, 0) : NULL;
+    if (mapping != NULL) CloseHandle(mapping);
+    CloseHandle(file);
+    *size = data != NULL ? (size_t) fileSize : 0;
+
+    return data;
+#else
+    int file = open(fileName, O_RDONLY);
+    if (file < 0) return NULL;
+    struct stat info;
+    void *data = fstat(file, &info) == 0 && info.st_size > 0 ? mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file);
+    *size = data != MAP_FAILED ? (size_t) info.st_size : 0;
+
+    return data != MAP_FAILED ? data : NULL;
+#endif
+}
+
+static void UnmapFileWithKerning(const unsigned char *data, size_t size)
+{
+    if (data == NULL) return;
+#if defined(_WIN32)
+    (void) size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void *) data, size);
+#endif
+}
+
+#define RLTEXTKERNER_SHARED_CACHE_MAGIC 0x524c4b01 // "RLK" & version, set in the shared cache state once it is ready
+#define RLTEXTKERNER_SHARED_CACHE_PROBES 64       // slots looked at for a glyph before giving up on the shared cache
+#define RLTEXTKERNER_SHARED_CACHE_TIMEOUT 1000000000ULL // nanoseconds a segment may stay in setup before another process takes it over
+
+// start of a shared cache segment, followed by the glyph table (offsets of the glyphs, 0 = empty slot) & the glyphs
+typedef struct SharedCacheHeaderWithKerning {
+    atomic_uint state;              // 0 = new, odd setup token = being set up, RLTEXTKERNER_SHARED_CACHE_MAGIC = ready
+    unsigned int size;              // bytes in the segment
+    unsigned int capacity;          // slots in the glyph table (a power of 2)
+    atomic_uint used;               // bytes allocated from the start of the segment (may pass size once it is full)
+} SharedCacheHeaderWithKerning;
+
+// glyph bitmap in a shared cache segment - the bitmap follows, & the glyph is never changed once added to the table
+typedef struct SharedGlyphWithKerning {
+    unsigned long long fontHash;    // hash of the font data the glyph was rendered from
+    unsigned long long key;         // glyph cache key
+    int source;                     // what the glyph was rendered with, like in the disk cache
+    int offsetY;
+    unsigned short width;
+    unsigned short height;
+    int reserved;
+} SharedGlyphWithKerning;
+
+// map a named shared memory segment into memory, creating it with size bytes if it doesn't exist yet - returns NULL
+// if it can't be opened, otherwise the size mapped (which is the size it was created with)
+static unsigned char *MapSharedMemoryWithKerning(const char *name, size_t size, size_t *mappedSize)
+{
+#if defined(_WIN32)
+    void *mapping = CreateFileMappingA((void *) -1, NULL, 4 /* PAGE_READWRITE */, (unsigned long) ((unsigned long long) size >> 32), (unsigned long) size, name);
+    unsigned char *data = mapping != NULL ? MapViewOfFile(mapping, 6 /* FILE_MAP_READ | FILE_MAP_WRITE */, 0, 0, 0) : NULL;
+    if (mapping != NULL) CloseHandle(mapping);
+    *mappedSize = data != NULL ? size : 0; // an existing mapping is mapped whole - only the size in its header is used
+
+    return data;
+#else
+    int file = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (file < 0) return NULL;
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size == 0 && ftruncate(file, size) == 0) fstat(file, &info);
+    void *data = info.st_size > 0 ? mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+    close(file);
+    *mappedSize = data != MAP_FAILED ? (size_t) info.st_size : 0;
+
+    return data != MAP_FAILED ? data : NULL;
+#endif
+}
+
+// glyphs drawn while recording a profile, in a hash set that is added to without locks
+typedef struct GlyphProfileWithKerning {
+    atomic_ullong keys[RLTEXTKERNER_PROFILE_GLYPHS];   // codepoint << 32 | glyph size << 8 | subpixel phase, + 1 (0 = empty slot)
+    atomic_ullong counts[RLTEXTKERNER_PROFILE_GLYPHS]; // times the glyph in each slot was drawn
+} GlyphProfileWithKerning;
+
+// glyph read from a profile file
+typedef struct ProfileGlyphWithKerning {
+    int codepoint;
+    float fontSize;
+    int phase;
+    unsigned long long count;
+} ProfileGlyphWithKerning;
+
+// glyphs rendered by a background prewarm
+typedef struct PrewarmWithKerning {
+    WorkerWithKerning worker;
+    FontWithKerning font;
+    ProfileGlyphWithKerning *glyphs;
+    int glyphCount;
+    bool started;           // false if the glyphs were rendered on the calling thread
+    atomic_bool stop;       // set when the font is unloaded
+    atomic_bool done;
+} PrewarmWithKerning;
+
+struct GlyphCacheWithKerning {
+    GlyphCacheShardWithKerning shards[RLTEXTKERNER_CACHE_SHARDS];
+    size_t limit;                   // most memory for cached glyphs (0 = no limit), split evenly between the shards
+    atomic_ullong epoch;
+    atomic_int readers[2];          // readers by the parity of the epoch they started in
+    atomic_ullong allocatedBytes;   // memory allocated for tables, slabs & glyphs too large for slabs
+    atomic_ullong evictions;
+    FontFaceWithKerning *face; // font file data & info, shared with other fonts loaded from the same data
+    FontWithKerning fallbacks[RLTEXTKERNER_MAX_FALLBACKS]; // fonts for codepoints the face has no glyph for, in order
+    int fallbackCount;
+    atomic_int refs;        // the font & its copies made with CopyFontWithKerning
+    size_t budget;          // memory budget in bytes (0 = no limit)
+    int sizeStep;           // font sizes sharing glyph bitmaps, in RLTEXTKERNER_SIZE_UNITS
+    char *diskCache;        // directory of the disk cache files (NULL = no disk cache)
+    DiskCacheFileWithKerning diskFiles[RLTEXTKERNER_MAX_FONT_SIZES]; // files looked up so far, by glyph size
+    atomic_int diskFileCount;
+    MutexWithKerning diskLock; // held when mapping files
+    unsigned char *shared;     // shared cache segment (NULL = no shared cache)
+    size_t sharedSize;         // bytes mapped
+    GlyphProfileWithKerning *profile; // glyphs counted while recording (NULL if never recorded)
+    bool recording;
+    PrewarmWithKerning *prewarm;      // last prewarm started (NULL if none)
+    unsigned int *kernPairs;   // glyph pairs of the corpus (first glyph << 16 | next glyph, 0 = empty slot)
+    int *kernAdvances;         // kerning of each pair, in the same allocation as the pairs
+    int kernPairCapacity;      // slots in the pair table (a power of two, 0 = no table)
+    Image *images;          // pre-rendered images of each font glyph, imageSizeCount per glyph
+    int *imageSizes;        // font size of each pre-rendered image of a glyph
+    int imageSizeCount;
+    SdfAtlasWithKerning sdf;   // distance fields glyph bitmaps are drawn from, if rendered (NULL rects otherwise)
+    FontSizeWithKerning sizes[RLTEXTKERNER_MAX_FONT_SIZES];
+    atomic_int sizeCount;
+    MutexWithKerning sizeLock; // held when adding sizes
+    atomic_ullong useClock;    // incremented each time a size is used
+    atomic_int missingCodepoints[RLTEXTKERNER_MAX_MISSING_GLYPHS]; // hash set of missing codepoints + 1 (0 = empty slot)
+    atomic_ullong missingCounts[RLTEXTKERNER_MAX_MISSING_GLYPHS];  // times the codepoint in each slot was kerned
+    atomic_int missingCount;
+#if defined(RLTEXTKERNER_STATS)
+    atomic_ullong stats[RLTEXTKERNER_STAT_COUNT]; // FontWithKerningStats fields, in order
+#endif
+};
+
+static unsigned long long GetCachedGlyphKeyWithKerning(int glyphIndex, int fontSize, int phase)
+{
+    return ((unsigned long long) (unsigned int) glyphIndex << 32) | ((unsigned long long) (fontSize & 0xffffff) << 8) | (unsigned int) phase;
+}
+
+static unsigned long long HashCachedGlyphKeyWithKerning(unsigned long long key)
+{
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+
+    return key;
+}
+
+static GlyphCacheShardWithKerning *GetGlyphCacheShardWithKerning(GlyphCacheWithKerning *cache, unsigned long long key)
+{
+    return &cache->shards[HashCachedGlyphKeyWithKerning(key) % RLTEXTKERNER_CACHE_SHARDS];
+}
+
+static GlyphTableWithKerning *LoadGlyphTableWithKerning(GlyphCacheWithKerning *cache, int capacity)
+{
+    GlyphTableWithKerning *table = RL_MALLOC(sizeof(*table) + capacity * sizeof(table->slots[0]));
+    if (table == NULL) return NULL;
+
+    table->previous = NULL;
+    table->retiredEpoch = 0;
+    table->capacity = capacity;
+    for (int i = 0; i < capacity; i++) atomic_init(&table->slots[i], NULL);
+    atomic_fetch_add_explicit(&cache->allocatedBytes, sizeof(*table) + capacity * sizeof(table->slots[0]), memory_order_relaxed);
+
+    return table;
+}
+
+static void UnloadGlyphTableWithKerning(GlyphCacheWithKerning *cache, GlyphTableWithKerning *table)
+{
+    atomic_fetch_sub_explicit(&cache->allocatedBytes, sizeof(*table) + table->capacity * sizeof(table->slots[0]), memory_order_relaxed);
+    RL_FREE(table);
+}
+
+// memory used by a cached glyph
+static size_t GetCachedGlyphSizeWithKerning(const CachedGlyphWithKerning *glyph)
+{
+    if (glyph->slabClass >= 0) return (size_t) 64 << glyph->slabClass;
+
+    return sizeof(*glyph) + (glyph->data == (unsigned char *) (glyph + 1) ? glyph->width * glyph->height : 0);
+}
+
+// allocate a glyph of size bytes from the shard slabs (shard locked)
+static CachedGlyphWithKerning *AllocCachedGlyphWithKerning(GlyphCacheWithKerning *cache, GlyphCacheShardWithKerning *shard, size_t size)
+{
+    CachedGlyphWithKerning *glyph;
+    int slabClass = 0;
+    while (slabClass < RLTEXTKERNER_SLAB_CLASSES && ((size_t) 64 << slabClass) < size) slabClass++;
+
+    if (slabClass == RLTEXTKERNER_SLAB_CLASSES) {
+        glyph = RL_MALLOC(size);
+        if (glyph == NULL) return NULL;
+        atomic_fetch_add_explicit(&cache->allocatedBytes, size, memory_order_relaxed);
+        slabClass = -1;
+    } else {
+        if (shard->freeBlocks[slabClass] == NULL) {
+            int blockSize = 64 << slabClass;
+            int blockCount = shard->slabBlocks[slabClass];
+            if (blockCount < 4) blockCount = 4;
+            if (blockCount > RLTEXTKERNER_SLAB_SIZE / blockSize) blockCount = RLTEXTKERNER_SLAB_SIZE / blockSize;
+            GlyphSlabWithKerning *slab = RL_MALLOC(sizeof(*slab) + blockCount * blockSize);
+            if (slab == NULL) return NULL;
+            slab->size = blockCount * blockSize;
+            atomic_fetch_add_explicit(&cache->allocatedBytes, sizeof(*slab) + slab->size, memory_order_relaxed);
+            slab->next = shard->slabs;
+            shard->slabs = slab;
+            shard->slabBlocks[slabClass] += blockCount;
+
+            for (int i = blockCount - 1; i >= 0; i--) {
+                void **block = (void **) ((unsigned char *) slab->blocks + i * blockSize);
+                *block = shard->freeBlocks[slabClass];
+                shard->freeBlocks[slabClass] = block;
+            }
+        }
+        glyph = shard->freeBlocks[slabClass];
+        shard->freeBlocks[slabClass] = *(void **) glyph;
+    }
+
+    glyph->slabClass = slabClass;
+    atomic_init(&glyph->referenced, true);
+    atomic_init(&glyph->pins, 0);
+
+    return glyph;
+}
+
+// return a glyph's memory to the shard slabs (shard locked)
+static void FreeCachedGlyphWithKerning(GlyphCacheWithKerning *cache, GlyphCacheShardWithKerning *shard, CachedGlyphWithKerning *glyph)
+{
+    if (glyph->slabClass < 0) {
+        atomic_fetch_sub_explicit(&cache->allocatedBytes, GetCachedGlyphSizeWithKerning(glyph), memory_order_relaxed);
+        RL_FREE(glyph);
+    } else {
+        int slabClass = glyph->slabClass;
+        *(void **) glyph = shard->freeBlocks[slabClass];
+        shard->freeBlocks[slabClass] = glyph;
+    }
+}
+
+static GlyphCacheWithKerning *LoadGlyphCacheWithKerning(void)
+{
+    GlyphCacheWithKerning *cache = RL_CALLOC(1, sizeof(*cache));
+    if (cache == NULL) return NULL;
+
+    atomic_init(&cache->allocatedBytes, 0);
+    atomic_init(&cache->refs, 1);
+    cache->sizeStep = RLTEXTKERNER_SIZE_UNITS / 4;
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        GlyphTableWithKerning *table = LoadGlyphTableWithKerning(cache, 64);
+        if (table == NULL) {
+            for (int j = 0; j < i; j++) {
+                RL_FREE(atomic_load(&cache->shards[j].table));
+                DestroyMutexWithKerning(&cache->shards[j].lock);
+            }
+            RL_FREE(cache);
+            return NULL;
+        }
+        atomic_init(&cache->shards[i].table, table);
+        InitMutexWithKerning(&cache->shards[i].lock);
+    }
+    atomic_init(&cache->epoch, 0);
+    atomic_init(&cache->readers[0], 0);
+    atomic_init(&cache->readers[1], 0);
+    atomic_init(&cache->evictions, 0);
+    atomic_init(&cache->sizeCount, 0);
+    atomic_init(&cache->useClock, 0);
+    InitMutexWithKerning(&cache->sizeLock);
+    InitMutexWithKerning(&cache->diskLock);
+
+    return cache;
+}
+
+// free the glyphs & tables retired at least two epochs ago, first advancing the epoch if no readers are left in the
+// previous one - or free everything retired if no other thread can be reading the cache (shard locked)
+static void ReclaimGlyphCacheWithKerning(GlyphCacheWithKerning *cache, GlyphCacheShardWithKerning *shard, bool all)
+{
+    unsigned long long epoch = atomic_load(&cache->epoch);
+    if (!all && atomic_load(&cache->readers[(epoch + 1) & 1]) == 0) {
+        if (atomic_compare_exchange_strong(&cache->epoch, &epoch, epoch + 1)) ++epoch;
+    }
+
+    // retired lists are newest first, so everything after the first old enough entry can be freed too
+    CachedGlyphWithKerning **glyph = &shard->retired;
+    while (*glyph != NULL && !all && (*glyph)->retiredEpoch + 2 > epoch) glyph = &(*glyph)->nextRetired;
+    for (CachedGlyphWithKerning *retired = *glyph, *next; retired != NULL; retired = next) {
+        next = retired->nextRetired;
+        FreeCachedGlyphWithKerning(cache, shard, retired);
+    }
+    *glyph = NULL;
+
+    GlyphTableWithKerning **table = &atomic_load_explicit(&shard->table, memory_order_relaxed)->previous;
+    while (*table != NULL && !all && (*table)->retiredEpoch + 2 > epoch) table = &(*table)->previous;
+    for (GlyphTableWithKerning *retired = *table, *next; retired != NULL; retired = next) {
+        next = retired->previous;
+        UnloadGlyphTableWithKerning(cache, retired);
+    }
+    *table = NULL;
+}
+
+static void UnloadGlyphCacheWithKerning(GlyphCacheWithKerning *cache)
+{
+    if (cache == NULL) return;
+
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        GlyphCacheShardWithKerning *shard = &cache->shards[i];
+        ReclaimGlyphCacheWithKerning(cache, shard, true);
+        GlyphTableWithKerning *table = atomic_load(&shard->table);
+        for (int j = 0; j < table->capacity; j++) {
+            CachedGlyphWithKerning *glyph = atomic_load(&table->slots[j]);
+            if (glyph != NULL && glyph != &glyphTombstone && glyph->slabClass < 0) RL_FREE(glyph);
+        }
+        RL_FREE(table);
+        for (GlyphSlabWithKerning *slab = shard->slabs, *next; slab != NULL; slab = next) {
+            next = slab->next;
+            RL_FREE(slab);
+        }
+        DestroyMutexWithKerning(&shard->lock);
+    }
+    DestroyMutexWithKerning(&cache->sizeLock);
+    for (int i = 0; i < atomic_load(&cache->diskFileCount); i++) {
+        UnmapFileWithKerning(cache->diskFiles[i].data, cache->diskFiles[i].size);
+        RL_FREE(cache->diskFiles[i].savedKeys);
+    }
+    DestroyMutexWithKerning(&cache->diskLock);
+    UnmapFileWithKerning(cache->shared, cache->sharedSize);
+    RL_FREE(cache->profile);
+    RL_FREE(cache->diskCache);
+    RL_FREE(cache->images);
+    RL_FREE(cache->imageSizes);
+    RL_FREE(cache);
+}
+
+// start reading glyphs from the cache, so glyphs evicted meanwhile aren't freed - returns the reader counter to pass to
+// LeaveGlyphCacheWithKerning
+static int EnterGlyphCacheWithKerning(GlyphCacheWithKerning *cache)
+{
+    if (cache->limit == 0) return -1; // nothing is evicted, so there is nothing to protect
+
+    for (;;) {
+        unsigned long long epoch = atomic_load(&cache->epoch);
+        int reader = epoch & 1;
+        atomic_fetch_add(&cache->readers[reader], 1);
+        if (atomic_load(&cache->epoch) == epoch) return reader;
+        atomic_fetch_sub(&cache->readers[reader], 1); // the epoch advanced meanwhile - count in the new one
+    }
+}
+
+static void LeaveGlyphCacheWithKerning(GlyphCacheWithKerning *cache, int reader)
+{
+    if (reader >= 0) atomic_fetch_sub_explicit(&cache->readers[reader], 1, memory_order_release);
+}
+
+// mark font size as used now, adding it to the tracked sizes if there is room
+static void UseFontSizeWithKerning(GlyphCacheWithKerning *cache, int fontSize)
+{
+    unsigned long long now = atomic_fetch_add_explicit(&cache->useClock, 1, memory_order_relaxed) + 1;
+    int count = atomic_load_explicit(&cache->sizeCount, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (cache->sizes[i].fontSize == fontSize) {
+            atomic_store_explicit(&cache->sizes[i].lastUse, now, memory_order_relaxed);
+            return;
+        }
+    }
+    if (count == RLTEXTKERNER_MAX_FONT_SIZES) return;
+
+    LockMutexWithKerning(&cache->sizeLock);
+    count = atomic_load_explicit(&cache->sizeCount, memory_order_relaxed);
+    int i = 0;
+    while (i < count && cache->sizes[i].fontSize != fontSize) i++;
+    if (i < RLTEXTKERNER_MAX_FONT_SIZES) {
+        if (i == count) {
+            cache->sizes[i].fontSize = fontSize;
+            atomic_init(&cache->sizes[i].lastUse, now);
+            atomic_store_explicit(&cache->sizeCount, count + 1, memory_order_release);
+        } else {
+            atomic_store_explicit(&cache->sizes[i].lastUse, now, memory_order_relaxed);
+        }
+    }
+    UnlockMutexWithKerning(&cache->sizeLock);
+}
+
+#if defined(RLTEXTKERNER_STATS)
+// add counters collected by one thread to the font stats - kerning collects them per string, so threads kerning with the
+// same font only touch the shared counters once per string
+static void AddFontStatsWithKerning(GlyphCacheWithKerning *cache, const FontWithKerningStats *stats)
+{
+    const unsigned long long *counters = (const unsigned long long *) stats;
+    for (int i = 0; i < RLTEXTKERNER_STAT_COUNT; i++) {
+        if (counters[i] != 0) atomic_fetch_add_explicit(&cache->stats[i], counters[i], memory_order_relaxed);
+    }
+}
+#endif
+
+FontWithKerningStats GetFontWithKerningStats(FontWithKerning font)
+{
+    FontWithKerningStats stats = { 0 };
+#if defined(RLTEXTKERNER_STATS)
+    if (font.cache != NULL) {
+        unsigned long long *counters = (unsigned long long *) &stats;
+        for (int i = 0; i < RLTEXTKERNER_STAT_COUNT; i++) {
+            counters[i] = atomic_load_explicit(&font.cache->stats[i], memory_order_relaxed);
+        }
+    }
+#else
+    (void) font;
+#endif
+
+    return stats;
+}
+
+// count a codepoint the font & its fallbacks have no glyph for, logging it the first time - this takes no locks & formats
+// no strings once the codepoint is known, so kerning text the font doesn't support stays cheap
+static void AddMissingGlyphWithKerning(GlyphCacheWithKerning *cache, int codepoint)
+{
+    if (codepoint < ' ') return; // control characters aren't drawn
+    unsigned int mask = RLTEXTKERNER_MAX_MISSING_GLYPHS - 1;
+    unsigned int slot = (unsigned int) HashCachedGlyphKeyWithKerning((unsigned int) codepoint) & mask;
+    for (unsigned int probe = 0; probe <= mask; probe++, slot = (slot + 1) & mask) {
+        int stored = atomic_load_explicit(&cache->missingCodepoints[slot], memory_order_relaxed);
+        if (stored == 0 && atomic_compare_exchange_strong_explicit(&cache->missingCodepoints[slot], &stored, codepoint + 1, memory_order_relaxed, memory_order_relaxed)) {
+            int count = atomic_fetch_add_explicit(&cache->missingCount, 1, memory_order_relaxed) + 1;
+            TraceLog(LOG_WARNING, "FONT: Unable to find glyph for codepoint %d", codepoint);
+            if (count == RLTEXTKERNER_MAX_MISSING_GLYPHS) {
+                TraceLog(LOG_WARNING, "FONT: Only the first %i missing codepoints are logged", RLTEXTKERNER_MAX_MISSING_GLYPHS);
+            }
+            stored = codepoint + 1;
+        }
+        if (stored == codepoint + 1) {
+            atomic_fetch_add_explicit(&cache->missingCounts[slot], 1, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+int GetFontWithKerningMissingGlyphs(FontWithKerning font, MissingGlyphWithKerning *missing, int maxCount)
+{
+    if (font.cache == NULL) return 0;
+
+    int count = 0;
+    for (int i = 0; i < RLTEXTKERNER_MAX_MISSING_GLYPHS; i++) {
+        int stored = atomic_load_explicit(&font.cache->missingCodepoints[i], memory_order_relaxed);
+        if (stored == 0) continue;
+        if (count < maxCount) {
+            missing[count].codepoint = stored - 1;
+            missing[count].count = atomic_load_explicit(&font.cache->missingCounts[i], memory_order_relaxed);
+        }
+        ++count;
+    }
+
+    return count;
+}
+
+void ResetFontWithKerningMissingGlyphs(FontWithKerning font)
+{
+    if (font.cache == NULL) return;
+
+    for (int i = 0; i < RLTEXTKERNER_MAX_MISSING_GLYPHS; i++) {
+        atomic_store_explicit(&font.cache->missingCodepoints[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&font.cache->missingCounts[i], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&font.cache->missingCount, 0, memory_order_relaxed);
+}
+
+void ResetFontWithKerningStats(FontWithKerning font)
+{
+#if defined(RLTEXTKERNER_STATS)
+    if (font.cache != NULL) {
+        for (int i = 0; i < RLTEXTKERNER_STAT_COUNT; i++) {
+            atomic_store_explicit(&font.cache->stats[i], 0, memory_order_relaxed);
+        }
+    }
+#else
+    (void) font;
+#endif
+}
+
+// find glyph in the cache without locking - returns NULL if it isn't cached
+static CachedGlyphWithKerning *FindCachedGlyphWithKerning(GlyphCacheWithKerning *cache, unsigned long long key)
+{
+    unsigned long long hash = HashCachedGlyphKeyWithKerning(key);
+    GlyphTableWithKerning *table = atomic_load_explicit(&cache->shards[hash % RLTEXTKERNER_CACHE_SHARDS].table, memory_order_acquire);
+    int mask = table->capacity - 1;
+
+    // tables are never more than half full (counting tombstones), so there is always an empty slot to end the search
+    for (int i = (hash >> 8) & mask; ; i = (i + 1) & mask) {
+        CachedGlyphWithKerning *glyph = atomic_load_explicit(&table->slots[i], memory_order_acquire);
+        if (glyph == NULL) return NULL;
+        if (glyph->key == key) return glyph;
+    }
+}
+
+// evict glyphs with the clock algorithm until bytes more fit within the shard's part of the cache limit - two turns of
+// the hand clear every referenced flag, so it only stops short if the remaining glyphs are pinned (shard locked)
+static void EvictCachedGlyphsWithKerning(GlyphCacheWithKerning *cache, GlyphCacheShardWithKerning *shard, size_t bytes)
+{
+    size_t shardLimit = cache->limit / RLTEXTKERNER_CACHE_SHARDS;
+    GlyphTableWithKerning *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+
+    for (int step = 0; step < table->capacity * 2 && shard->bytes + bytes > shardLimit; step++) {
+        int i = shard->hand;
+        shard->hand = (shard->hand + 1) & (table->capacity - 1);
+        CachedGlyphWithKerning *glyph = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+        if (glyph == NULL || glyph == &glyphTombstone || atomic_load_explicit(&glyph->pins, memory_order_relaxed) > 0) continue;
+        if (atomic_load_explicit(&glyph->referenced, memory_order_relaxed)) {
+            atomic_store_explicit(&glyph->referenced, false, memory_order_relaxed);
+            continue;
+        }
+
+        // readers may still hold the glyph, so retire it instead of freeing it
+        atomic_store(&table->slots[i], &glyphTombstone);
+        glyph->retiredEpoch = atomic_load(&cache->epoch);
+        glyph->nextRetired = shard->retired;
+        shard->retired = glyph;
+        shard->bytes -= GetCachedGlyphSizeWithKerning(glyph);
+        --shard->count;
+        ++shard->tombstones;
+        atomic_fetch_add_explicit(&cache->evictions, 1, memory_order_relaxed);
+    }
+}
+
+// add glyph to the cache, taking ownership of it - returns the glyph already cached if another thread added the same
+// key first (in which case the passed glyph is freed)
+static CachedGlyphWithKerning *AddCachedGlyphWithKerning(GlyphCacheWithKerning *cache, CachedGlyphWithKerning *glyph)
+{
+    unsigned long long hash = HashCachedGlyphKeyWithKerning(glyph->key);
+    GlyphCacheShardWithKerning *shard = &cache->shards[hash % RLTEXTKERNER_CACHE_SHARDS];
+    size_t size = GetCachedGlyphSizeWithKerning(glyph);
+
+    LockMutexWithKerning(&shard->lock);
+    if (cache->limit > 0) EvictCachedGlyphsWithKerning(cache, shard, size);
+    GlyphTableWithKerning *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+
+    // replace the table with one without tombstones, twice the size unless most slots were tombstones - readers still
+    // see the old table until the new one is published
+    if ((shard->count + shard->tombstones + 1) * 2 > table->capacity) {
+        int capacity = (shard->count + 1) * 4 > table->capacity ? table->capacity * 2 : table->capacity;
+        GlyphTableWithKerning *grown = LoadGlyphTableWithKerning(cache, capacity);
+        if (grown != NULL) {
+            int mask = grown->capacity - 1;
+            for (int i = 0; i < table->capacity; i++) {
+                CachedGlyphWithKerning *cached = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+                if (cached == NULL || cached == &glyphTombstone) continue;
+                int j = (HashCachedGlyphKeyWithKerning(cached->key) >> 8) & mask;
+                while (atomic_load_explicit(&grown->slots[j], memory_order_relaxed) != NULL) j = (j + 1) & mask;
+                atomic_store_explicit(&grown->slots[j], cached, memory_order_relaxed);
+            }
+            table->retiredEpoch = atomic_load(&cache->epoch);
+            grown->previous = table;
+            atomic_store_explicit(&shard->table, grown, memory_order_release);
+            table = grown;
+            shard->tombstones = 0;
+            shard->hand = 0;
+        } else if ((shard->count + shard->tombstones + 1) * 2 > table->capacity + table->capacity / 2) {
+            // out of memory and the table is too full to keep lookups fast - don't cache the glyph
+            FreeCachedGlyphWithKerning(cache, shard, glyph);
+            UnlockMutexWithKerning(&shard->lock);
+            return NULL;
+        }
+    }
+
+    int mask = table->capacity - 1;
+    int i = (hash >> 8) & mask;
+    int slot = -1; // first tombstone on the way, reused for the glyph
+    for (CachedGlyphWithKerning *cached; (cached = atomic_load_explicit(&table->slots[i], memory_order_relaxed)) != NULL; i = (i + 1) & mask) {
+        if (cached == &glyphTombstone) {
+            if (slot < 0) slot = i;
+        } else if (cached->key == glyph->key) {
+            FreeCachedGlyphWithKerning(cache, shard, glyph);
+            UnlockMutexWithKerning(&shard->lock);
+            return cached;
+        }
+    }
+    if (slot >= 0) --shard->tombstones;
+    else slot = i;
+    atomic_store_explicit(&table->slots[slot], glyph, memory_order_release);
+    ++shard->count;
+    shard->bytes += size;
+    if (cache->limit > 0) ReclaimGlyphCacheWithKerning(cache, shard, false);
+    UnlockMutexWithKerning(&shard->lock);
+
+    return glyph;
+}
+
+// add to the pin count of a cached glyph - returns false if the glyph isn't cached
+static bool PinCachedGlyphWithKerning(GlyphCacheWithKerning *cache, unsigned long long key, int pins)
+{
+    GlyphCacheShardWithKerning *shard = GetGlyphCacheShardWithKerning(cache, key);
+
+    // glyphs are only evicted with the shard locked, so the glyph found stays in the cache
+    LockMutexWithKerning(&shard->lock);
+    CachedGlyphWithKerning *glyph = FindCachedGlyphWithKerning(cache, key);
+    if (glyph != NULL) {
+        int count = atomic_load_explicit(&glyph->pins, memory_order_relaxed) + pins;
+        atomic_store_explicit(&glyph->pins, count > 0 ? count : 0, memory_order_relaxed);
+    }
+    UnlockMutexWithKerning(&shard->lock);
+
+    return glyph != NULL;
+}
+
+Image CreateGlyphImageWithKerning(FontWithKerning font, int codepoint, float fontScale)
+{
+    Image image = { 0 };
+    int glyphIndex = FindFaceGlyphWithKerning(font.cache->face, codepoint);
+    const GlyphOutlineWithKerning *outline = GetGlyphOutlineWithKerning(font.cache->face, glyphIndex);
+    if (outline != NULL) {
+        int x0, y0, x1, y1;
+        GetGlyphOutlineBoxWithKerning(outline, fontScale, 0, &x0, &y0, &x1, &y1);
+        image.width = x1 - x0;
+        image.height = y1 - y0;
+        if (image.width > 0 && image.height > 0) {
+            image.data = RL_MALLOC(image.width * image.height);
+            if (image.data != NULL) RasterizeGlyphOutlineWithKerning(outline, image.data, image.width, image.height, fontScale, 0, x0, y0);
+        }
+    } else {
+        image.data = stbtt_GetGlyphBitmap(font.info, fontScale, fontScale, glyphIndex, &image.width, &image.height, NULL, NULL);
+    }
+    image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+    image.mipmaps = 1;
+
+    return image;
+}
+
+FontWithKerning LoadFontWithKerning(const char *fileName, int baseFontSize)
+{
+    return LoadFontWithKerningEx(fileName, baseFontSize, NULL, 0);
+}
+
+FontWithKerning LoadFontWithKerningEx(const char *fileName, int baseFontSize, const int *codepoints, int codepointCount)
+{
+    FontWithKerning font = { 0 };
+
+    if (!IsFileExtension(fileName, ".ttf") && !IsFileExtension(fileName, ".otf")) {
+        TraceLog(LOG_WARNING, "FONT: Error loading font (%s) with kerning - file must be either TTF or OTF.", fileName);
+
+        return font;
+    }
+
+    // Loading file to memory
+    int dataSize = 0;
+    unsigned char *fileData = LoadFileData(fileName, &dataSize);
+
+    if (fileData == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error loading file %s", fileName);
+
+        return font;
+    }
+
+    return LoadFontWithKerningFromMemory(fileData, baseFontSize, dataSize, codepoints, codepointCount);
+}
+
+FontWithKerning LoadFontWithKerningFromMemory(const unsigned char *fileData, int baseFontSize, int dataSize, const int *codepoints, int codepointCount)
+{
+    FontWithKerning font = { 0 };
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_LOAD, 'B', 0, baseFontSize, 0, 0));
+
+    font.cache = LoadGlyphCacheWithKerning();
+    FontFaceWithKerning *face = font.cache != NULL ? LoadFontFaceWithKerning(fileData, dataSize) : NULL;
+    if (face != NULL) {
+        font.info = &face->info;
+        font.cache->face = face;
+        TraceLog(LOG_INFO, "FONT: TTF font TTF info loaded successfully. Kerning enabled: %s", font.info->gpos || font.info->kern ? "true" : "false");
+        // load default glyphs
+        font.glyphCount = (codepointCount > 0) ? codepointCount : 95;
+        font.codepoints = RL_MALLOC(font.glyphCount * 4 * sizeof(int));
+
+        if (font.codepoints != NULL) {
+            font.glyphIndices = font.codepoints + font.glyphCount;
+            font.advances = font.glyphIndices + font.glyphCount;
+            font.bearings = font.advances + font.glyphCount;
+            for (int i=0; i < font.glyphCount; i++) {
+                int codepoint;
+                if (codepoints == NULL) codepoint = i + 32;
+                else codepoint = codepoints[i];
+                font.codepoints[i] = codepoint;
+                font.glyphIndices[i] = FindFaceGlyphWithKerning(face, codepoint);
+                GetFaceHMetricsWithKerning(face, font.glyphIndices[i], &font.advances[i], &font.bearings[i]);
+            }
+            // rasterize the glyph bitmaps for the base font size in parallel
+            font.cache->images = RL_CALLOC(font.glyphCount, sizeof(*font.cache->images));
+            font.cache->imageSizes = RL_MALLOC(sizeof(*font.cache->imageSizes));
+            if (font.cache->images != NULL && font.cache->imageSizes != NULL) {
+                float fontScale = stbtt_ScaleForPixelHeight(font.info, baseFontSize);
+                RasterizeGlyphsWithKerning(font, font.cache->images, 1, &fontScale, 1, 0, fontThreadCount);
+                font.cache->imageSizes[0] = baseFontSize;
+                font.cache->imageSizeCount = 1;
+            }
+            UseFontSizeWithKerning(font.cache, baseFontSize * RLTEXTKERNER_SIZE_UNITS);
+            TraceLog(LOG_INFO, "FONT: TTF font glyphs loaded successfully (%i glyphs)", font.glyphCount);
+        } else {
+            TraceLog(LOG_WARNING, "FONT: Error allocating memory for font glyphs");
+            font.glyphCount = 0;
+        }
+    } else {
+        TraceLog(LOG_WARNING, "FONT: Error loading TTF font info! Font unusable with kerning.");
+        UnloadGlyphCacheWithKerning(font.cache);
+        font.cache = NULL;
+    }
+
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_LOAD, 'E', 0, baseFontSize, font.glyphCount, 0));
+
+    return font;
+}
+
+void UpdateFontWithKerningBitmaps(FontWithKerning *font, int fontSize)
+{
+    UpdateFontWithKerningBitmapsEx(font, &fontSize, 1, fontThreadCount);
+}
+
+void UpdateFontWithKerningBitmapsEx(FontWithKerning *font, const int *fontSizes, int fontSizeCount, int threadCount)
+{
+    if (font->glyphCount == 0 || fontSizeCount <= 0) return;
+
+    float *fontScales = RL_MALLOC(fontSizeCount * sizeof(*fontScales));
+    if (fontScales == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error updating font glyph memory!");
+        return;
+    }
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_UPDATE, 'B', 0, fontSizes[0], 0, 0));
+    for (int i=0; i<fontSizeCount; i++) {
+        fontScales[i] = stbtt_ScaleForPixelHeight(font->info, fontSizes[i]);
+    }
+
+    // make room for the new images of each glyph first, so the workers only ever write to their own image
+    int firstImage = font->cache->imageSizeCount;
+    int imageCount = firstImage + fontSizeCount;
+    Image *images = RL_MALLOC(font->glyphCount * imageCount * sizeof(*images));
+    int *imageSizes = RL_REALLOC(font->cache->imageSizes, imageCount * sizeof(*imageSizes));
+    if (imageSizes != NULL) font->cache->imageSizes = imageSizes;
+    if (images == NULL || imageSizes == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error updating font glyph memory!");
+        RL_FREE(images);
+        RL_FREE(fontScales);
+        RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_UPDATE, 'E', 0, fontSizes[0], 0, 0));
+        return;
+    }
+    for (int i=0; i<font->glyphCount; i++) {
+        memcpy(images + i * imageCount, font->cache->images + i * firstImage, firstImage * sizeof(*images));
+    }
+
+    RasterizeGlyphsWithKerning(*font, images, imageCount, fontScales, fontSizeCount, firstImage, threadCount);
+    RL_FREE(font->cache->images);
+    font->cache->images = images;
+    for (int i=0; i<fontSizeCount; i++) {
+        font->cache->imageSizes[firstImage + i] = fontSizes[i];
+        UseFontSizeWithKerning(font->cache, fontSizes[i] * RLTEXTKERNER_SIZE_UNITS);
+    }
+    font->cache->imageSizeCount = imageCount;
+    TrimFontWithKerningMemory(font);
+
+    RL_FREE(fontScales);
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_UPDATE, 'E', 0, fontSizes[0], font->glyphCount * fontSizeCount, 0));
+}
+
+void SetFontWithKerningFallbacks(FontWithKerning font, const FontWithKerning *fallbacks, int count)
+{
+    if (font.cache == NULL) return;
+    if (count > RLTEXTKERNER_MAX_FALLBACKS) {
+        TraceLog(LOG_WARNING, "FONT: Only the first %i fallback fonts are used", RLTEXTKERNER_MAX_FALLBACKS);
+        count = RLTEXTKERNER_MAX_FALLBACKS;
+    }
+
+    font.cache->fallbackCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (fallbacks[i].cache == NULL) continue; // failed to load
+        font.cache->fallbacks[font.cache->fallbackCount++] = fallbacks[i];
+    }
+}
+
+// find the position of the codepoint in the font glyph arrays - returns -1 if it wasn't loaded
+static int FindGlyphWithKerning(FontWithKerning font, int codepoint)
+{
+    for (int i = 0; i < font.glyphCount; i++) {
+        if (font.codepoints[i] == codepoint) return i;
+    }
+
+    return -1;
+}
+
+// find the slot of a glyph pair in a kerning pair table - the pair's slot if it has one, otherwise the empty slot for it
+static int FindKernPairWithKerning(const unsigned int *pairs, int capacity, unsigned int pair)
+{
+    int slot = (int) (HashCachedGlyphKeyWithKerning(pair) & (capacity - 1));
+    while (pairs[slot] != 0 && pairs[slot] != pair) slot = (slot + 1) & (capacity - 1);
+
+    return slot;
+}
+
+// get the kerning between two glyphs of the font, from the pairs of its corpus if it has them (font units)
+static int GetKernAdvanceWithKerning(FontWithKerning font, int glyphIndex, int nextGlyphIndex)
+{
+    const GlyphCacheWithKerning *cache = font.cache;
+    if (cache->kernPairCapacity > 0 && glyphIndex > 0) {
+        unsigned int pair = (unsigned int) glyphIndex << 16 | (unsigned int) nextGlyphIndex;
+        int slot = FindKernPairWithKerning(cache->kernPairs, cache->kernPairCapacity, pair);
+        if (cache->kernPairs[slot] == pair) return cache->kernAdvances[slot];
+    }
+
+    return stbtt_GetGlyphKernAdvance(font.info, glyphIndex, nextGlyphIndex);
+}
+
+typedef struct SdfJobsWithKerning {
+    FontWithKerning font;
+    float fontScale;
+    Image *fields;          // distance field of each glyph
+    int *rects;             // the offsets are set for each glyph, the rest once the fields are packed
+    atomic_int nextJob;
+} SdfJobsWithKerning;
+
+static void RenderSdfJobsWithKerning(void *arg)
+{
+    SdfJobsWithKerning *jobs = arg;
+    for (int glyph = atomic_fetch_add(&jobs->nextJob, 1); glyph < jobs->font.glyphCount; glyph = atomic_fetch_add(&jobs->nextJob, 1)) {
+        Image *field = &jobs->fields[glyph];
+        int *rect = &jobs->rects[glyph * 6];
+        field->data = stbtt_GetGlyphSDF(jobs->font.info, jobs->fontScale, jobs->font.glyphIndices[glyph], RLTEXTKERNER_SDF_PADDING,
+                                        RLTEXTKERNER_SDF_ON_EDGE, RLTEXTKERNER_SDF_PIXEL_DISTANCE, &field->width, &field->height, &rect[4], &rect[5]);
+    }
+}
+
+// order glyphs by the height of their distance fields (packed in the low & high bits), tallest first
+static int CompareSdfGlyphsWithKerning(const void *a, const void *b)
+{
+    long long first = *(const long long *) a, second = *(const long long *) b;
+
+    return first < second ? 1 : (first > second ? -1 : 0);
+}
+
+void UpdateFontWithKerningSdf(FontWithKerning *font, int fontSize)
+{
+    if (font->cache == NULL) return;
+    SdfAtlasWithKerning *sdf = &font->cache->sdf;
+    UnloadImage(sdf->image);
+    RL_FREE(sdf->rects);
+    *sdf = (SdfAtlasWithKerning){ 0 };
+    if (fontSize <= 0) return;
+
+    // render the distance fields on the worker threads
+    SdfJobsWithKerning jobs = { .font = *font, .fontScale = stbtt_ScaleForPixelHeight(font->info, fontSize) };
+    atomic_init(&jobs.nextJob, 0);
+    jobs.fields = RL_CALLOC(font->glyphCount, sizeof(*jobs.fields));
+    jobs.rects = RL_CALLOC(font->glyphCount * 6, sizeof(*jobs.rects));
+    long long *order = RL_MALLOC(font->glyphCount * sizeof(*order));
+    if (jobs.fields == NULL || jobs.rects == NULL || order == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for SDF atlas");
+        RL_FREE(jobs.fields);
+        RL_FREE(jobs.rects);
+        RL_FREE(order);
+        return;
+    }
+    int threadCount = GetThreadCountWithKerning(fontThreadCount);
+    if (threadCount > font->glyphCount / 16) threadCount = font->glyphCount / 16;
+    RunWorkersWithKerning(threadCount < 1 ? 1 : threadCount, RenderSdfJobsWithKerning, &jobs);
+
+    // pack the fields into shelves, tallest first, in a square-ish power of two wide image
+    size_t area = 0;
+    for (int i = 0; i < font->glyphCount; i++) {
+        area += (size_t) (jobs.fields[i].width + 1) * (jobs.fields[i].height + 1);
+        order[i] = ((long long) jobs.fields[i].height << 32) | i;
+    }
+    qsort(order, font->glyphCount, sizeof(*order), CompareSdfGlyphsWithKerning);
+    int width = 64;
+    while ((size_t) width * width < area) width *= 2;
+    int x = 0, y = 0, shelfHeight = 0;
+    for (int i = 0; i < font->glyphCount; i++) {
+        int glyph = (int) (order[i] & 0xffffffff);
+        int *rect = &jobs.rects[glyph * 6];
+        if (x + jobs.fields[glyph].width > width) {
+            x = 0;
+            y += shelfHeight + 1;
+            shelfHeight = 0;
+        }
+        rect[0] = x;
+        rect[1] = y;
+        rect[2] = jobs.fields[glyph].width;
+        rect[3] = jobs.fields[glyph].height;
+        x += rect[2] + 1; // a pixel between fields, so texture filtering doesn't bleed between them
+        if (rect[3] > shelfHeight) shelfHeight = rect[3];
+    }
+
+    sdf->image.data = RL_CALLOC((size_t) width * (y + shelfHeight), 1);
+    if (sdf->image.data != NULL) {
+        sdf->image.width = width;
+        sdf->image.height = y + shelfHeight;
+        sdf->image.mipmaps = 1;
+        sdf->image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+        sdf->fontSize = fontSize;
+        sdf->fontScale = jobs.fontScale;
+        sdf->rects = jobs.rects;
+        for (int glyph = 0; glyph < font->glyphCount; glyph++) {
+            const int *rect = &jobs.rects[glyph * 6];
+            for (int row = 0; row < rect[3]; row++) {
+                memcpy((unsigned char *) sdf->image.data + (rect[1] + row) * width + rect[0], (unsigned char *) jobs.fields[glyph].data + row * rect[2], rect[2]);
+            }
+        }
+    } else {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for SDF atlas");
+        RL_FREE(jobs.rects);
+    }
+
+    for (int i = 0; i < font->glyphCount; i++) stbtt_FreeSDF(jobs.fields[i].data, NULL);
+    RL_FREE(jobs.fields);
+    RL_FREE(order);
+}
+
+Image GetFontWithKerningSdfAtlas(FontWithKerning font)
+{
+    return font.cache != NULL ? font.cache->sdf.image : (Image){ 0 };
+}
+
+// draw a glyph bitmap from the glyph's distance field in the SDF atlas, like RasterizeGlyphOutlineWithKerning - each
+// pixel samples the distance at its center (bilinearly) & turns it into coverage, half on the outline
+static void DrawSdfGlyphWithKerning(const SdfAtlasWithKerning *sdf, int glyph, unsigned char *data, int width, int height, float fontScale, float shiftX, int x0, int y0)
+{
+    const int *rect = &sdf->rects[glyph * 6];
+    const unsigned char *field = (const unsigned char *) sdf->image.data + rect[1] * sdf->image.width + rect[0];
+    int stride = sdf->image.width;
+    float step = sdf->fontScale / fontScale; // atlas pixels per bitmap pixel
+    float distanceScale = 1 / (RLTEXTKERNER_SDF_PIXEL_DISTANCE * step); // distance field steps to bitmap pixels
+
+    for (int y = 0; y < height; y++) {
+        float fieldY = (y0 + y + 0.5f) * step - rect[5] - 0.5f;
+        fieldY = fieldY < 0 ? 0 : (fieldY > rect[3] - 1 ? rect[3] - 1 : fieldY);
+        int top = (int) fieldY;
+        float fractionY = fieldY - top;
+        const unsigned char *row = field + top * stride;
+        const unsigned char *nextRow = top + 1 < rect[3] ? row + stride : row;
+        for (int x = 0; x < width; x++) {
+            float fieldX = (x0 + x + 0.5f - shiftX) * step - rect[4] - 0.5f;
+            fieldX = fieldX < 0 ? 0 : (fieldX > rect[2] - 1 ? rect[2] - 1 : fieldX);
+            int left = (int) fieldX;
+            int right = left + 1 < rect[2] ? left + 1 : left;
+            float fractionX = fieldX - left;
+            float upper = row[left] + (row[right] - row[left]) * fractionX;
+            float lower = nextRow[left] + (nextRow[right] - nextRow[left]) * fractionX;
+            float coverage = 0.5f + (upper + (lower - upper) * fractionY - RLTEXTKERNER_SDF_ON_EDGE) * distanceScale;
+            data[y * width + x] = coverage <= 0 ? 0 : (coverage >= 1 ? 255 : (unsigned char) (coverage * 255 + 0.5f));
+        }
+    }
+}
+
+#if !defined(RLTEXTKERNER_NO_RAYLIB)
+// smooth step over the width of a screen pixel around the edge, which fwidth gives in distance field units
+static const char *sdfShaderCode =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform vec4 colDiffuse;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float distance = texture(texture0, fragTexCoord).r - 128.0/255.0;\n"
+    "    float edge = 0.7*fwidth(distance);\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a*smoothstep(-edge, edge, distance))*colDiffuse;\n"
+    "}\n";
+
+Shader LoadSdfShaderWithKerning(void)
+{
+    return LoadShaderFromMemory(NULL, sdfShaderCode);
+}
+
+void DrawTextSdfWithKerning(FontWithKerning font, Texture2D atlas, const char *text, Vector2 position, float fontSize, Color tint)
+{
+    if (font.cache == NULL || font.cache->sdf.rects == NULL || text == NULL) return;
+    const SdfAtlasWithKerning *sdf = &font.cache->sdf;
+    int ascent, descent, lineGap;
+    stbtt_GetFontVMetrics(font.info, &ascent, &descent, &lineGap);
+    float fontScale = stbtt_ScaleForPixelHeight(font.info, fontSize);
+    float step = fontScale / sdf->fontScale; // screen pixels per atlas pixel
+
+    // pen position on the baseline, moved by each glyph's advance & kerning with the next glyph
+    float x = position.x;
+    float y = position.y + ascent * fontScale;
+    int size = 0;
+    int codepoint = GetCodepointNext(text, &size);
+    while (codepoint != 0) {
+        text += size;
+        int nextCodepoint = GetCodepointNext(text, &size);
+        if (codepoint == '\n') {
+            x = position.x;
+            y += (ascent - descent + lineGap) * fontScale;
+        } else {
+            int glyph = FindGlyphWithKerning(font, codepoint);
+            int glyphIndex = glyph >= 0 ? font.glyphIndices[glyph] : FindFaceGlyphWithKerning(font.cache->face, codepoint);
+            if (glyph >= 0 && sdf->rects[glyph * 6 + 2] > 0) {
+                const int *rect = &sdf->rects[glyph * 6];
+                Rectangle source = { (float) rect[0], (float) rect[1], (float) rect[2], (float) rect[3] };
+                Rectangle dest = { x + rect[4] * step, y + rect[5] * step, rect[2] * step, rect[3] * step };
+                DrawTexturePro(atlas, source, dest, (Vector2){ 0, 0 }, 0, tint);
+            }
+            int advanceX, lsb;
+            if (glyph >= 0) advanceX = font.advances[glyph];
+            else GetFaceHMetricsWithKerning(font.cache->face, glyphIndex, &advanceX, &lsb);
+            int kern = nextCodepoint != 0 ? GetKernAdvanceWithKerning(font, glyphIndex, FindFaceGlyphWithKerning(font.cache->face, nextCodepoint)) : 0;
+            x += (advanceX + kern) * fontScale;
+        }
+        codepoint = nextCodepoint;
+    }
+}
+#endif
+
+FontWithKerning CopyFontWithKerning(FontWithKerning font)
+{
+    if (font.cache != NULL) atomic_fetch_add_explicit(&font.cache->refs, 1, memory_order_relaxed);
+
+    return font;
+}
+
+// stop the background prewarm of the font if it is running & free it
+static void StopPrewarmWithKerning(GlyphCacheWithKerning *cache)
+{
+    PrewarmWithKerning *prewarm = cache->prewarm;
+    if (prewarm == NULL) return;
+
+    atomic_store_explicit(&prewarm->stop, true, memory_order_relaxed);
+    if (prewarm->started) JoinWorkerWithKerning(&prewarm->worker);
+    RL_FREE(prewarm->glyphs);
+    RL_FREE(prewarm);
+    cache->prewarm = NULL;
+}
+
+void UnloadFontWithKerning(FontWithKerning font)
+{
+    if (font.cache == NULL) return;
+    // the last copy frees the font
+    if (atomic_fetch_sub_explicit(&font.cache->refs, 1, memory_order_acq_rel) > 1) return;
+
+    StopPrewarmWithKerning(font.cache);
+
+    if (font.cache->diskCache != NULL) SaveFontWithKerningDiskCache(font);
+    if (font.cache->images) {
+        for (int i=0; i<font.glyphCount * font.cache->imageSizeCount; i++) {
+            UnloadImage(font.cache->images[i]);
+        }
+    }
+    UnloadImage(font.cache->sdf.image);
+    RL_FREE(font.cache->sdf.rects);
+    RL_FREE(font.cache->kernPairs);
+    RL_FREE(font.codepoints);
+    FontFaceWithKerning *face = font.cache->face;
+    UnloadGlyphCacheWithKerning(font.cache);
+    UnloadFontFaceWithKerning(face);
+}
+
+// get size of a table in the font file (0 if the font doesn't have it)
+static size_t GetFontTableSizeWithKerning(const stbtt_fontinfo *info, const char *tag)
+{
+    const unsigned char *data = info->data + info->fontstart;
+    int tableCount = data[4] << 8 | data[5];
+    for (int i = 0; i < tableCount; i++) {
+        const unsigned char *record = data + 12 + 16 * i;
+        if (memcmp(record, tag, 4) == 0) return (size_t) record[12] << 24 | record[13] << 16 | record[14] << 8 | record[15];
+    }
+
+    return 0;
+}
+
+// get usage entry for a font size, adding it if there is room - returns NULL if there isn't
+static FontWithKerningSizeUsage *GetFontSizeUsageWithKerning(FontWithKerningMemoryUsage *usage, GlyphCacheWithKerning *cache, int fontSize)
+{
+    for (int i = 0; i < usage->sizeCount; i++) {
+        if (usage->sizes[i].fontSize * RLTEXTKERNER_SIZE_UNITS == fontSize) return &usage->sizes[i];
+    }
+    if (usage->sizeCount == RLTEXTKERNER_MAX_FONT_SIZES) return NULL;
+
+    FontWithKerningSizeUsage *size = &usage->sizes[usage->sizeCount++];
+    *size = (FontWithKerningSizeUsage){ .fontSize = (float) fontSize / RLTEXTKERNER_SIZE_UNITS };
+    int count = atomic_load_explicit(&cache->sizeCount, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (cache->sizes[i].fontSize == fontSize) size->lastUse = atomic_load_explicit(&cache->sizes[i].lastUse, memory_order_relaxed);
+    }
+
+    return size;
+}
+
+FontWithKerningMemoryUsage GetFontWithKerningMemoryUsage(FontWithKerning font)
+{
+    FontWithKerningMemoryUsage usage = { 0 };
+    if (font.info == NULL || font.cache == NULL) return usage;
+
+    usage.fontData = font.cache->face->dataSize;
+    usage.kerningTables = GetFontTableSizeWithKerning(font.info, "kern") + GetFontTableSizeWithKerning(font.info, "GPOS");
+    int imageCount = font.cache->imageSizeCount;
+    usage.metrics = sizeof(FontFaceWithKerning) + font.cache->face->cmapPageCount * (256 * sizeof(unsigned short) + 4 * sizeof(unsigned long long)) + font.info->numGlyphs * sizeof(GlyphHMetricsWithKerning) + font.glyphCount * 4 * sizeof(int) + imageCount * sizeof(int) + font.glyphCount * imageCount * sizeof(Image);
+    usage.metrics += font.cache->kernPairCapacity * (sizeof(*font.cache->kernPairs) + sizeof(*font.cache->kernAdvances));
+
+    // pre-rendered bitmaps
+    for (int j = 0; j < imageCount; j++) {
+        FontWithKerningSizeUsage *size = GetFontSizeUsageWithKerning(&usage, font.cache, font.cache->imageSizes[j] * RLTEXTKERNER_SIZE_UNITS);
+        for (int i = 0; i < font.glyphCount; i++) {
+            const Image *image = &font.cache->images[i * imageCount + j];
+            size_t bytes = (size_t) image->width * image->height;
+            usage.bitmaps += bytes;
+            if (size != NULL) size->bitmapBytes += bytes;
+        }
+    }
+
+    // glyph cache - read like the kerning functions do, so this is safe while other threads add & evict glyphs
+    usage.glyphCache = sizeof(*font.cache) + atomic_load_explicit(&font.cache->allocatedBytes, memory_order_relaxed);
+    usage.glyphCacheLimit = font.cache->limit;
+    usage.evictions = atomic_load_explicit(&font.cache->evictions, memory_order_relaxed);
+    int reader = EnterGlyphCacheWithKerning(font.cache);
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        GlyphTableWithKerning *table = atomic_load_explicit(&font.cache->shards[i].table, memory_order_acquire);
+        for (int j = 0; j < table->capacity; j++) {
+            CachedGlyphWithKerning *cached = atomic_load_explicit(&table->slots[j], memory_order_acquire);
+            if (cached == NULL || cached == &glyphTombstone) continue;
+            ++usage.cachedGlyphs;
+            if (atomic_load_explicit(&cached->pins, memory_order_relaxed) > 0) ++usage.pinnedGlyphs;
+            FontWithKerningSizeUsage *size = GetFontSizeUsageWithKerning(&usage, font.cache, (int) ((cached->key >> 8) & 0xffffff));
+            if (size != NULL) {
+                size->cacheBytes += GetCachedGlyphSizeWithKerning(cached);
+                ++size->cachedGlyphs;
+            }
+        }
+    }
+    LeaveGlyphCacheWithKerning(font.cache, reader);
+
+    usage.outlines = atomic_load_explicit(&font.cache->face->outlineBytes, memory_order_relaxed);
+    if (font.cache->sdf.rects != NULL) {
+        usage.sdfAtlas = (size_t) font.cache->sdf.image.width * font.cache->sdf.image.height + font.glyphCount * 6 * sizeof(int);
+    }
+    for (int i = 0; i < atomic_load_explicit(&font.cache->diskFileCount, memory_order_acquire); i++) usage.diskCache += font.cache->diskFiles[i].size;
+    if (font.cache->shared != NULL) {
+        const SharedCacheHeaderWithKerning *header = (const SharedCacheHeaderWithKerning *) font.cache->shared;
+        unsigned int used = atomic_load_explicit(&((SharedCacheHeaderWithKerning *) header)->used, memory_order_relaxed);
+        usage.sharedCache = used < header->size ? used : header->size;
+    }
+    usage.total = usage.fontData + usage.metrics + usage.outlines + usage.bitmaps + usage.sdfAtlas + usage.glyphCache;
+
+    return usage;
+}
+
+void SetFontWithKerningMemoryBudget(FontWithKerning *font, size_t budget)
+{
+    if (font->cache == NULL) return;
+
+    font->cache->budget = budget;
+    TrimFontWithKerningMemory(font);
+}
+
+// move the glyphs of a shard into new slabs & free the old ones, returning the memory of evicted glyphs - no other thread
+// may be using the font (shard locked)
+static void CompactGlyphCacheShardWithKerning(GlyphCacheWithKerning *cache, GlyphCacheShardWithKerning *shard)
+{
+    ReclaimGlyphCacheWithKerning(cache, shard, true);
+
+    GlyphSlabWithKerning *slabs = shard->slabs;
+    shard->slabs = NULL;
+    for (int i = 0; i < RLTEXTKERNER_SLAB_CLASSES; i++) {
+        shard->freeBlocks[i] = NULL;
+        shard->slabBlocks[i] = 0;
+    }
+
+    GlyphTableWithKerning *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    for (int i = 0; i < table->capacity; i++) {
+        CachedGlyphWithKerning *glyph = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+        if (glyph == NULL || glyph == &glyphTombstone || glyph->slabClass < 0) continue;
+
+        size_t size = (size_t) 64 << glyph->slabClass;
+        CachedGlyphWithKerning *moved = AllocCachedGlyphWithKerning(cache, shard, size);
+        if (moved == NULL) {
+            // out of memory - keep the old slabs as well, as they still hold glyphs
+            GlyphSlabWithKerning **last = &shard->slabs;
+            while (*last != NULL) last = &(*last)->next;
+            *last = slabs;
+            return;
+        }
+        bool referenced = atomic_load_explicit(&glyph->referenced, memory_order_relaxed);
+        int pins = atomic_load_explicit(&glyph->pins, memory_order_relaxed);
+        memcpy(moved, glyph, size);
+        atomic_init(&moved->referenced, referenced);
+        atomic_init(&moved->pins, pins);
+        if (glyph->data == (unsigned char *) (glyph + 1)) moved->data = (unsigned char *) (moved + 1);
+        atomic_store_explicit(&table->slots[i], moved, memory_order_relaxed);
+    }
+
+    for (GlyphSlabWithKerning *slab = slabs, *next; slab != NULL; slab = next) {
+        next = slab->next;
+        atomic_fetch_sub_explicit(&cache->allocatedBytes, sizeof(*slab) + slab->size, memory_order_relaxed);
+        RL_FREE(slab);
+    }
+}
+
+// check if a cached glyph's bitmap is one of the pre-rendered images for a font size (in RLTEXTKERNER_SIZE_UNITS), rather
+// than its own memory or a glyph in a disk or shared cache
+static bool IsPreRenderedGlyphWithKerning(const FontWithKerning *font, const CachedGlyphWithKerning *cached, int fontSize)
+{
+    const GlyphCacheWithKerning *cache = font->cache;
+    for (int j = 0; j < cache->imageSizeCount; j++) {
+        if (cache->imageSizes[j] * RLTEXTKERNER_SIZE_UNITS != fontSize) continue;
+        for (int i = 0; i < font->glyphCount; i++) {
+            if (cache->images[i * cache->imageSizeCount + j].data == cached->data) return true;
+        }
+    }
+
+    return false;
+}
+
+// free the pre-rendered & cached bitmaps for a font size (in RLTEXTKERNER_SIZE_UNITS), except pinned glyphs - no other
+// thread may be using the font
+static void EvictFontSizeWithKerning(FontWithKerning *font, int fontSize)
+{
+    GlyphCacheWithKerning *cache = font->cache;
+
+    // rebuild each shard table without the glyphs for the size
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        GlyphCacheShardWithKerning *shard = &cache->shards[i];
+        LockMutexWithKerning(&shard->lock);
+        GlyphTableWithKerning *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+        CachedGlyphWithKerning **kept = RL_MALLOC((shard->count > 0 ? shard->count : 1) * sizeof(*kept));
+        if (kept == NULL) {
+            UnlockMutexWithKerning(&shard->lock);
+            continue;
+        }
+
+        int keptCount = 0;
+        for (int j = 0; j < table->capacity; j++) {
+            CachedGlyphWithKerning *cached = atomic_load_explicit(&table->slots[j], memory_order_relaxed);
+            if (cached == NULL) continue;
+            atomic_store_explicit(&table->slots[j], NULL, memory_order_relaxed);
+            if (cached == &glyphTombstone) continue;
+            bool evicted = (int) ((cached->key >> 8) & 0xffffff) == fontSize;
+            if (evicted && atomic_load_explicit(&cached->pins, memory_order_relaxed) > 0) {
+                // pinned glyphs stay, with a copy of their bitmap if it is a pre-rendered image that is about to be freed
+                evicted = false;
+                if (IsPreRenderedGlyphWithKerning(font, cached, fontSize)) {
+                    CachedGlyphWithKerning *copy = AllocCachedGlyphWithKerning(cache, shard, sizeof(*copy) + cached->width * cached->height);
+                    if (copy != NULL) {
+                        copy->key = cached->key;
+                        copy->width = cached->width;
+                        copy->height = cached->height;
+                        copy->offsetY = cached->offsetY;
+                        atomic_init(&copy->pins, atomic_load_explicit(&cached->pins, memory_order_relaxed));
+                        copy->data = (unsigned char *) (copy + 1);
+                        memcpy(copy->data, cached->data, (size_t) cached->width * cached->height);
+                        shard->bytes += GetCachedGlyphSizeWithKerning(copy);
+                    } else {
+                        TraceLog(LOG_WARNING, "FONT: Error allocating memory for a pinned glyph, it is evicted");
+                    }
+                    shard->bytes -= GetCachedGlyphSizeWithKerning(cached);
+                    FreeCachedGlyphWithKerning(cache, shard, cached);
+                    cached = copy;
+                    evicted = copy == NULL;
+                }
+            }
+            if (evicted) {
+                shard->bytes -= GetCachedGlyphSizeWithKerning(cached);
+                FreeCachedGlyphWithKerning(cache, shard, cached);
+            } else {
+                kept[keptCount++] = cached;
+            }
+        }
+        int mask = table->capacity - 1;
+        for (int j = 0; j < keptCount; j++) {
+            int k = (HashCachedGlyphKeyWithKerning(kept[j]->key) >> 8) & mask;
+            while (atomic_load_explicit(&table->slots[k], memory_order_relaxed) != NULL) k = (k + 1) & mask;
+            atomic_store_explicit(&table->slots[k], kept[j], memory_order_relaxed);
+        }
+        shard->count = keptCount;
+        shard->tombstones = 0;
+        shard->hand = 0;
+        RL_FREE(kept);
+        CompactGlyphCacheShardWithKerning(cache, shard);
+        UnlockMutexWithKerning(&shard->lock);
+    }
+
+    // remove the pre-rendered images for the size from every glyph
+    for (int j = cache->imageSizeCount - 1; j >= 0; j--) {
+        if (cache->imageSizes[j] * RLTEXTKERNER_SIZE_UNITS != fontSize) continue;
+        int kept = 0;
+        for (int i = 0; i < font->glyphCount * cache->imageSizeCount; i++) {
+            if (i % cache->imageSizeCount == j) UnloadImage(cache->images[i]);
+            else cache->images[kept++] = cache->images[i];
+        }
+        memmove(cache->imageSizes + j, cache->imageSizes + j + 1, (cache->imageSizeCount - j - 1) * sizeof(*cache->imageSizes));
+        --cache->imageSizeCount;
+    }
+}
+
+size_t TrimFontWithKerningMemory(FontWithKerning *font)
+{
+    GlyphCacheWithKerning *cache = font->cache;
+    if (cache == NULL) return 0;
+
+    // no other thread can be reading the cache, so free everything retired & the memory of evicted glyphs first
+    size_t startTotal = GetFontWithKerningMemoryUsage(*font).total;
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        LockMutexWithKerning(&cache->shards[i].lock);
+        CompactGlyphCacheShardWithKerning(cache, &cache->shards[i]);
+        UnlockMutexWithKerning(&cache->shards[i].lock);
+    }
+
+    // free sizes, least recently used first, until within budget
+    FontWithKerningMemoryUsage usage = GetFontWithKerningMemoryUsage(*font);
+    if (cache->budget > 0) {
+        while (usage.total > cache->budget) {
+            FontWithKerningSizeUsage *oldest = NULL;
+            for (int i = 0; i < usage.sizeCount; i++) {
+                FontWithKerningSizeUsage *size = &usage.sizes[i];
+                if (size->bitmapBytes + size->cacheBytes == 0) continue;
+                if (oldest == NULL || size->lastUse < oldest->lastUse) oldest = size;
+            }
+            if (oldest == NULL) break;
+
+            size_t total = usage.total;
+            EvictFontSizeWithKerning(font, (int) (oldest->fontSize * RLTEXTKERNER_SIZE_UNITS));
+            usage = GetFontWithKerningMemoryUsage(*font);
+            if (usage.total >= total) break; // out of memory rebuilding the tables
+        }
+    }
+
+    return startTotal > usage.total ? startTotal - usage.total : 0;
+}
+
+Image KernTextWrapped(const char *text, FontWithKerning font, float fontSize, int maxWidth)
+{
+#if defined(RLTEXTKERNER_NO_RAYLIB)
+    return KernTextEx(text, font, fontSize, maxWidth, RLTEXTKERNER_MAX_TEXT_HEIGHT, 1, 1);
+#else
+    return KernTextEx(text, font, fontSize, maxWidth, GetScreenHeight(), 1, 1);
+#endif
+}
+
+Image KernText(const char *text, FontWithKerning font, float fontSize)
+{
+#if defined(RLTEXTKERNER_NO_RAYLIB)
+    return KernTextEx(text, font, fontSize, RLTEXTKERNER_MAX_TEXT_WIDTH, RLTEXTKERNER_MAX_TEXT_HEIGHT, 0, 1);
+#else
+    return KernTextEx(text, font, fontSize, GetScreenWidth(), GetScreenHeight(), 0, 1);
+#endif
+}
+
+// font metrics for a font size, shared by every string kerned at that size
+typedef struct KernMetricsWithKerning {
+    float fontSize;
+    float fontScale;
+    int glyphSize;     // size step the glyph bitmaps are cached at, in RLTEXTKERNER_SIZE_UNITS
+    float glyphScale;  // scale of the glyph bitmaps
+    int ascent;        // pixels from the top of a line to the baseline
+    int lineHeight;    // pixels from one line to the next
+} KernMetricsWithKerning;
+
+// memory reused from one kerned string to the next - the bitmap is all zeros between strings
+typedef struct KernScratchWithKerning {
+    unsigned char *bitmap;
+    int bitmapSize;
+    int *codepoints;
+    int codepointCapacity;
+    int *glyphIndices;          // glyph index of each codepoint in the font it is drawn with
+    unsigned char *glyphFonts;  // font each codepoint is drawn with (0 = the font, 1... = its fallbacks)
+    int *advances;              // advance of each codepoint's glyph, unscaled
+    int *bearings;              // left side bearing of each codepoint's glyph, unscaled
+    int glyphCapacity;
+} KernScratchWithKerning;
+
+// memory stb_truetype allocates from while rasterizing a glyph, which is all freed again before the glyph is done - it
+// grows to fit the largest glyph rasterized by the thread, so after that rasterizing needs no allocations
+typedef struct KernArenaWithKerning {
+    unsigned char *data;
+    size_t size;
+    size_t used;
+    size_t overflow;    // bytes allocated with RL_MALLOC as the arena was full, added to its size once the glyph is done
+    bool active;        // set while rasterizing a glyph for the glyph cache (other allocations must outlive the arena)
+} KernArenaWithKerning;
+
+// scratch memory of the thread calling the KernText functions, kept until the thread calls UnloadKernTextScratch
+static _Thread_local KernScratchWithKerning threadScratch = { 0 };
+static _Thread_local KernArenaWithKerning threadArena = { 0 };
+
+#if defined(RLTEXTKERNER_ARENA)
+static void *AllocKernArenaWithKerning(size_t size)
+{
+    KernArenaWithKerning *arena = &threadArena;
+    size = (size + 15) & ~(size_t) 15; // keep allocations aligned for any type
+    if (!arena->active || arena->used + size > arena->size) {
+        if (arena->active) arena->overflow += size;
+        return RL_MALLOC(size);
+    }
+
+    void *ptr = arena->data + arena->used;
+    arena->used += size;
+
+    return ptr;
+}
+
+static void FreeKernArenaWithKerning(void *ptr)
+{
+    KernArenaWithKerning *arena = &threadArena;
+    unsigned char *bytes = ptr;
+    // memory in the arena is freed all at once when the glyph is done
+    if (arena->data != NULL && bytes >= arena->data && bytes < arena->data + arena->size) return;
+    RL_FREE(ptr);
+}
+#endif
+
+static void BeginKernArenaWithKerning(void)
+{
+    threadArena.active = true;
+}
+
+// free everything allocated from the arena, growing it if it was too small
+static void EndKernArenaWithKerning(void)
+{
+    KernArenaWithKerning *arena = &threadArena;
+    if (arena->overflow > 0) {
+        size_t size = (arena->size + arena->overflow + 4095) & ~(size_t) 4095;
+        unsigned char *data = RL_MALLOC(size);
+        if (data != NULL) {
+            RL_FREE(arena->data);
+            arena->data = data;
+            arena->size = size;
+        }
+    }
+    arena->used = 0;
+    arena->overflow = 0;
+    arena->active = false;
+}
+
+// get font metrics for a font size, marking its size step as used (for freeing the sizes used least recently)
+static KernMetricsWithKerning GetKernMetricsWithKerning(FontWithKerning font, float fontSize)
+{
+    KernMetricsWithKerning metrics = { 0 };
+    int ascent, descent, lineGap;
+    stbtt_GetFontVMetrics(font.info, &ascent, &descent, &lineGap);
+    metrics.fontSize = fontSize;
+    metrics.fontScale = stbtt_ScaleForPixelHeight(font.info, fontSize);
+    int step = font.cache->sizeStep;
+    metrics.glyphSize = (int) roundf(fontSize * RLTEXTKERNER_SIZE_UNITS / step) * step;
+    if (metrics.glyphSize > 0xffffff) metrics.glyphSize = 0xffffff;
+    metrics.glyphScale = stbtt_ScaleForPixelHeight(font.info, (float) metrics.glyphSize / RLTEXTKERNER_SIZE_UNITS);
+    metrics.ascent = roundf(ascent * metrics.fontScale);
+    metrics.lineHeight = metrics.ascent - (int) roundf(descent * metrics.fontScale) + (int) roundf(lineGap * metrics.fontScale);
+    UseFontSizeWithKerning(font.cache, metrics.glyphSize);
+
+    return metrics;
+}
+
+static void UnloadKernScratchWithKerning(KernScratchWithKerning *scratch)
+{
+    RL_FREE(scratch->bitmap);
+    RL_FREE(scratch->codepoints);
+    RL_FREE(scratch->glyphIndices);
+    RL_FREE(scratch->glyphFonts);
+    RL_FREE(scratch->advances);
+    RL_FREE(scratch->bearings);
+    *scratch = (KernScratchWithKerning){ 0 };
+}
+
+void UnloadKernTextScratch(void)
+{
+    UnloadKernScratchWithKerning(&threadScratch);
+    RL_FREE(threadArena.data);
+    threadArena = (KernArenaWithKerning){ 0 };
+}
+
+// get next codepoint in UTF-8 text & its size in bytes (invalid UTF-8 decodes to '?')
+static int GetCodepointWithKerning(const char *text, int *codepointSize)
+{
+    const unsigned char *ptr = (const unsigned char *) text;
+    int codepoint = '?';
+    *codepointSize = 1;
+
+    if ((ptr[0] & 0xf8) == 0xf0) {
+        if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80 || (ptr[3] & 0xc0) != 0x80) return codepoint;
+        codepoint = ((ptr[0] & 0x07) << 18) | ((ptr[1] & 0x3f) << 12) | ((ptr[2] & 0x3f) << 6) | (ptr[3] & 0x3f);
+        *codepointSize = 4;
+    } else if ((ptr[0] & 0xf0) == 0xe0) {
+        if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80) return codepoint;
+        codepoint = ((ptr[0] & 0x0f) << 12) | ((ptr[1] & 0x3f) << 6) | (ptr[2] & 0x3f);
+        *codepointSize = 3;
+    } else if ((ptr[0] & 0xe0) == 0xc0) {
+        if ((ptr[1] & 0xc0) != 0x80) return codepoint;
+        codepoint = ((ptr[0] & 0x1f) << 6) | (ptr[1] & 0x3f);
+        *codepointSize = 2;
+    } else if ((ptr[0] & 0x80) == 0) {
+        codepoint = ptr[0];
+    }
+
+    return codepoint;
+}
+
+// decode UTF-8 text into the scratch codepoints - returns the number of codepoints, or -1 if out of memory
+static int LoadScratchCodepointsWithKerning(KernScratchWithKerning *scratch, const char *text)
+{
+    int textSize = (int) strlen(text);
+    if (textSize > scratch->codepointCapacity) {
+        int *codepoints = RL_REALLOC(scratch->codepoints, textSize * sizeof(*codepoints));
+        if (codepoints == NULL) return -1;
+        scratch->codepoints = codepoints;
+        scratch->codepointCapacity = textSize;
+    }
+
+    int count = 0;
+    for (int i = 0, size; i < textSize; i += size) {
+        scratch->codepoints[count++] = GetCodepointWithKerning(text + i, &size);
+    }
+
+    return count;
+}
+
+static Image KernCodepointsWithScratch(const int *codepoints, int codepointsCount, FontWithKerning font, KernMetricsWithKerning metrics, int maxWidth, int maxHeight, int wrap, int subpixel, KernScratchWithKerning *scratch);
+
+Image KernTextEx(const char *text, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel)
+{
+    Image result = { 0 };
+    int codepointsCount = LoadScratchCodepointsWithKerning(&threadScratch, text);
+    if (codepointsCount >= 0) {
+        result = KernCodepointsWithScratch(threadScratch.codepoints, codepointsCount, font, GetKernMetricsWithKerning(font, fontSize), maxWidth, maxHeight, wrap, subpixel, &threadScratch);
+    } else {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for text codepoints");
+    }
+
+    return result;
+}
+
+// strings left to kern in a KernTextBatch call
+typedef struct KernBatchWithKerning {
+    const char **texts;
+    int count;
+    FontWithKerning font;
+    KernMetricsWithKerning metrics;
+    int maxWidth;
+    int maxHeight;
+    int wrap;
+    int subpixel;
+    Image *images;
+    atomic_int next;    // next string to be picked up by a worker
+} KernBatchWithKerning;
+
+static void KernBatchWorkerWithKerning(void *arg)
+{
+    KernBatchWithKerning *batch = arg;
+
+    for (int i = atomic_fetch_add(&batch->next, 1); i < batch->count; i = atomic_fetch_add(&batch->next, 1)) {
+        int codepointsCount = LoadScratchCodepointsWithKerning(&threadScratch, batch->texts[i]);
+        if (codepointsCount >= 0) {
+            batch->images[i] = KernCodepointsWithScratch(threadScratch.codepoints, codepointsCount, batch->font, batch->metrics, batch->maxWidth, batch->maxHeight, batch->wrap, batch->subpixel, &threadScratch);
+        } else {
+            TraceLog(LOG_WARNING, "FONT: Error allocating memory for text codepoints");
+            batch->images[i] = (Image){ 0 };
+        }
+    }
+}
+
+void KernTextBatch(const char **texts, int count, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel, int threadCount, Image *images)
+{
+    assert(font.info);
+    assert(maxWidth > 0);
+    assert(maxHeight > 0);
+
+    KernBatchWithKerning batch = { .texts = texts, .count = count, .font = font, .metrics = GetKernMetricsWithKerning(font, fontSize),
+                                   .maxWidth = maxWidth, .maxHeight = maxHeight, .wrap = wrap, .subpixel = subpixel, .images = images };
+    atomic_init(&batch.next, 0);
+
+    // short strings are quick to kern, so don't start threads that would only get a few of them
+    threadCount = GetThreadCountWithKerning(threadCount);
+    if (threadCount > count / 4) threadCount = count / 4;
+    if (threadCount < 1) threadCount = 1;
+
+    RunWorkersWithKerning(threadCount, KernBatchWorkerWithKerning, &batch);
+}
+
+int GetGlyphIndexWithKerning(FontWithKerning font, int codepoint)
+{
+    return FindFaceGlyphWithKerning(font.cache->face, codepoint);
+}
+
+void SetFontWithKerningDiskCache(FontWithKerning font, const char *directory)
+{
+    if (font.cache == NULL) return;
+
+    // files already mapped stay mapped until the font is unloaded, as cached glyphs may point into them
+    RL_FREE(font.cache->diskCache);
+    font.cache->diskCache = NULL;
+    for (int i = 0; i < atomic_load_explicit(&font.cache->diskFileCount, memory_order_relaxed); i++) {
+        RL_FREE(font.cache->diskFiles[i].savedKeys);
+        font.cache->diskFiles[i].savedKeys = NULL;
+        font.cache->diskFiles[i].savedCount = 0;
+    }
+    if (directory != NULL) {
+        font.cache->diskCache = RL_MALLOC(strlen(directory) + 1);
+        if (font.cache->diskCache != NULL) strcpy(font.cache->diskCache, directory);
+    }
+}
+
+// get what the glyphs of a glyph size are rendered from, so glyphs rendered another way aren't reused
+static int GetGlyphSourceWithKerning(const GlyphCacheWithKerning *cache, int glyphSize)
+{
+    if (cache->sdf.rects != NULL && glyphSize * 2 >= cache->sdf.fontSize * RLTEXTKERNER_SIZE_UNITS) return -cache->sdf.fontSize;
+
+    return atomic_load_explicit(&glyphRasterizer, memory_order_relaxed);
+}
+
+static bool GetDiskCacheFileNameWithKerning(const GlyphCacheWithKerning *cache, int glyphSize, char *fileName, size_t size)
+{
+    int length = snprintf(fileName, size, "%s/%016llx-%d.rlkc", cache->diskCache, cache->face->hash, glyphSize);
+
+    return length > 0 && (size_t) length < size - 4; // room to add .tmp
+}
+
+// get the disk cache file for a glyph size, mapping it the first time - returns NULL if there is no valid file
+static const DiskCacheFileWithKerning *GetDiskCacheFileWithKerning(GlyphCacheWithKerning *cache, int glyphSize)
+{
+    const DiskCacheFileWithKerning *file = NULL;
+    int count = atomic_load_explicit(&cache->diskFileCount, memory_order_acquire);
+    for (int i = 0; i < count && file == NULL; i++) {
+        if (cache->diskFiles[i].glyphSize == glyphSize) file = &cache->diskFiles[i];
+    }
+    if (file == NULL && count < RLTEXTKERNER_MAX_FONT_SIZES) {
+        LockMutexWithKerning(&cache->diskLock);
+        count = atomic_load_explicit(&cache->diskFileCount, memory_order_relaxed);
+        int i = 0;
+        while (i < count && cache->diskFiles[i].glyphSize != glyphSize) i++;
+        if (i == count && count < RLTEXTKERNER_MAX_FONT_SIZES) {
+            DiskCacheFileWithKerning *added = &cache->diskFiles[i];
+            char fileName[4096];
+            *added = (DiskCacheFileWithKerning){ .glyphSize = glyphSize };
+            if (GetDiskCacheFileNameWithKerning(cache, glyphSize, fileName, sizeof(fileName))) added->data = MapFileWithKerning(fileName, &added->size);
+
+            // ignore files that are damaged or from other font data or settings
+            const DiskCacheHeaderWithKerning *header = (const DiskCacheHeaderWithKerning *) added->data;
+            if (added->data != NULL && (added->size < sizeof(*header) || memcmp(header->magic, "RLKC", 4) != 0 ||
+                header->version != RLTEXTKERNER_DISK_CACHE_VERSION || header->fontHash != cache->face->hash ||
+                header->glyphSize != glyphSize || header->phases != RLTEXTKERNER_SUBPIXEL_PHASES || header->glyphCount < 0 ||
+                (added->size - sizeof(*header)) / sizeof(DiskCacheGlyphWithKerning) < (size_t) header->glyphCount)) {
+                TraceLog(LOG_WARNING, "FONT: Ignoring invalid disk cache file %s", fileName);
+                UnmapFileWithKerning(added->data, added->size);
+                added->data = NULL;
+                added->size = 0;
+            }
+            atomic_store_explicit(&cache->diskFileCount, count + 1, memory_order_release);
+        }
+        file = i < RLTEXTKERNER_MAX_FONT_SIZES ? &cache->diskFiles[i] : NULL;
+        UnlockMutexWithKerning(&cache->diskLock);
+    }
+
+    if (file == NULL || file->data == NULL) return NULL;
+    const DiskCacheHeaderWithKerning *header = (const DiskCacheHeaderWithKerning *) file->data;
+
+    return header->source == GetGlyphSourceWithKerning(cache, glyphSize) ? file : NULL;
+}
+
+// find a glyph in a disk cache file, returns NULL if it isn't there
+static const DiskCacheGlyphWithKerning *FindDiskCacheGlyphWithKerning(const DiskCacheFileWithKerning *file, unsigned int key)
+{
+    const DiskCacheHeaderWithKerning *header = (const DiskCacheHeaderWithKerning *) file->data;
+    const DiskCacheGlyphWithKerning *glyphs = (const DiskCacheGlyphWithKerning *) (header + 1);
+    int low = 0, high = header->glyphCount - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (glyphs[middle].key < key) low = middle + 1;
+        else if (glyphs[middle].key > key) high = middle - 1;
+        else {
+            const DiskCacheGlyphWithKerning *glyph = &glyphs[middle];
+            return glyph->offset <= file->size && (size_t) glyph->width * glyph->height <= file->size - glyph->offset ? glyph : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+// key of a cached glyph in disk cache files
+static unsigned int GetDiskCacheKeyWithKerning(unsigned long long key)
+{
+    return (unsigned int) (key >> 32) << 8 | (unsigned int) (key & 0xff);
+}
+
+// order cached glyphs by glyph size & then their key in disk cache files
+static int CompareDiskCacheGlyphsWithKerning(const void *a, const void *b)
+{
+    unsigned long long first = (*(CachedGlyphWithKerning *const *) a)->key, second = (*(CachedGlyphWithKerning *const *) b)->key;
+    unsigned long long firstOrder = ((first >> 8) & 0xffffff) << 40 | GetDiskCacheKeyWithKerning(first);
+    unsigned long long secondOrder = ((second >> 8) & 0xffffff) << 40 | GetDiskCacheKeyWithKerning(second);
+
+    return firstOrder < secondOrder ? -1 : (firstOrder > secondOrder ? 1 : 0);
+}
+
+// write the disk cache file for a glyph size with the cached glyphs (sorted by key) & the glyphs of the mapped file that
+// aren't cached - the file is written next to the old one & then replaces it, so the old one can stay mapped
+static bool SaveDiskCacheFileWithKerning(GlyphCacheWithKerning *cache, int glyphSize, CachedGlyphWithKerning **cached, int cachedCount)
+{
+    const DiskCacheFileWithKerning *file = GetDiskCacheFileWithKerning(cache, glyphSize);
+    const DiskCacheHeaderWithKerning *oldHeader = file != NULL ? (const DiskCacheHeaderWithKerning *) file->data : NULL;
+    const DiskCacheGlyphWithKerning *oldGlyphs = oldHeader != NULL ? (const DiskCacheGlyphWithKerning *) (oldHeader + 1) : NULL;
+    int oldCount = oldHeader != NULL ? oldHeader->glyphCount : 0;
+
+    // skip sizes where every cached glyph came from the file, or was written by the last save of the size
+    DiskCacheFileWithKerning *entry = NULL;
+    for (int i = 0; i < atomic_load_explicit(&cache->diskFileCount, memory_order_acquire); i++) {
+        if (cache->diskFiles[i].glyphSize == glyphSize) entry = &cache->diskFiles[i];
+    }
+    bool changed = false;
+    LockMutexWithKerning(&cache->diskLock);
+    for (int i = 0; i < cachedCount && !changed; i++) {
+        if (file != NULL && cached[i]->data >= file->data && cached[i]->data < file->data + file->size) continue;
+        unsigned int key = GetDiskCacheKeyWithKerning(cached[i]->key);
+        int low = 0, high = entry != NULL ? entry->savedCount : 0;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (entry->savedKeys[middle] < key) low = middle + 1;
+            else high = middle;
+        }
+        changed = entry == NULL || low == entry->savedCount || entry->savedKeys[low] != key;
+    }
+    UnlockMutexWithKerning(&cache->diskLock);
+    if (!changed) return true;
+
+    char fileName[4096], tempName[4100];
+    if (!GetDiskCacheFileNameWithKerning(cache, glyphSize, fileName, sizeof(fileName))) return false;
+    snprintf(tempName, sizeof(tempName), "%s.tmp", fileName);
+
+    // merge the glyphs by key, with the bitmap of each glyph
+    DiskCacheGlyphWithKerning *glyphs = RL_MALLOC((cachedCount + oldCount) * sizeof(*glyphs));
+    const unsigned char **bitmaps = RL_MALLOC((cachedCount + oldCount) * sizeof(*bitmaps));
+    FILE *output = glyphs != NULL && bitmaps != NULL ? fopen(tempName, "wb") : NULL;
+    if (output == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Unable to write disk cache file %s", tempName);
+        RL_FREE(glyphs);
+        RL_FREE(bitmaps);
+        return false;
+    }
+    int count = 0;
+    unsigned int offset = sizeof(DiskCacheHeaderWithKerning) + (cachedCount + oldCount) * sizeof(*glyphs);
+    for (int i = 0, j = 0; i < cachedCount || j < oldCount;) {
+        unsigned int cachedKey = i < cachedCount ? GetDiskCacheKeyWithKerning(cached[i]->key) : ~0u;
+        if (j < oldCount && (i == cachedCount || oldGlyphs[j].key <= cachedKey)) {
+            if (oldGlyphs[j].key == cachedKey) i++; // the cached glyph has the same bitmap
+            if (FindDiskCacheGlyphWithKerning(file, oldGlyphs[j].key) != NULL) {
+                glyphs[count] = oldGlyphs[j];
+                bitmaps[count++] = file->data + oldGlyphs[j].offset;
+            }
+            j++;
+        } else {
+            const CachedGlyphWithKerning *glyph = cached[i++];
+            glyphs[count] = (DiskCacheGlyphWithKerning){ cachedKey, (unsigned short) glyph->width, (unsigned short) glyph->height, glyph->offsetY, 0 };
+            bitmaps[count++] = glyph->data;
+        }
+    }
+    offset -= (cachedCount + oldCount - count) * sizeof(*glyphs);
+    for (int i = 0; i < count; i++) {
+        glyphs[i].offset = offset;
+        offset += glyphs[i].width * glyphs[i].height;
+    }
+
+    DiskCacheHeaderWithKerning header = { { 'R', 'L', 'K', 'C' }, RLTEXTKERNER_DISK_CACHE_VERSION, cache->face->hash, glyphSize,
+                                          RLTEXTKERNER_SUBPIXEL_PHASES, GetGlyphSourceWithKerning(cache, glyphSize), count };
+    bool saved = fwrite(&header, sizeof(header), 1, output) == 1 && fwrite(glyphs, sizeof(*glyphs), count, output) == (size_t) count;
+    for (int i = 0; i < count && saved; i++) {
+        size_t size = glyphs[i].width * glyphs[i].height;
+        saved = fwrite(bitmaps[i], 1, size, output) == size;
+    }
+    saved = fclose(output) == 0 && saved;
+    if (saved) {
+#if defined(_WIN32)
+        saved = MoveFileExA(tempName, fileName, 1 /* MOVEFILE_REPLACE_EXISTING */) != 0;
+#else
+        saved = rename(tempName, fileName) == 0; // replaces the old file atomically
+#endif
+    }
+    if (!saved) {
+        TraceLog(LOG_WARNING, "FONT: Unable to write disk cache file %s", fileName);
+        remove(tempName);
+    }
+
+    // remember what was saved, so the next save skips the size until more glyphs are cached
+    unsigned int *savedKeys = saved && entry != NULL ? RL_MALLOC((count > 0 ? count : 1) * sizeof(*savedKeys)) : NULL;
+    if (savedKeys != NULL) {
+        for (int i = 0; i < count; i++) savedKeys[i] = glyphs[i].key;
+        LockMutexWithKerning(&cache->diskLock);
+        RL_FREE(entry->savedKeys);
+        entry->savedKeys = savedKeys;
+        entry->savedCount = count;
+        UnlockMutexWithKerning(&cache->diskLock);
+    }
+    RL_FREE(glyphs);
+    RL_FREE(bitmaps);
+
+    return saved;
+}
+
+bool SaveFontWithKerningDiskCache(FontWithKerning font)
+{
+    GlyphCacheWithKerning *cache = font.cache;
+    if (cache == NULL || cache->diskCache == NULL || cache->face->hash == 0) return false;
+
+    // gather the cached glyphs like GetFontWithKerningMemoryUsage, so they stay valid while other threads render
+    bool saved = true;
+    int reader = EnterGlyphCacheWithKerning(cache);
+    GlyphTableWithKerning *tables[RLTEXTKERNER_CACHE_SHARDS];
+    int capacity = 0;
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        tables[i] = atomic_load_explicit(&cache->shards[i].table, memory_order_acquire);
+        capacity += tables[i]->capacity;
+    }
+    CachedGlyphWithKerning **glyphs = RL_MALLOC(capacity * sizeof(*glyphs));
+    if (glyphs == NULL) {
+        LeaveGlyphCacheWithKerning(cache, reader);
+        return false;
+    }
+    int count = 0;
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        for (int j = 0; j < tables[i]->capacity; j++) {
+            CachedGlyphWithKerning *cached = atomic_load_explicit(&tables[i]->slots[j], memory_order_acquire);
+            if (cached != NULL && cached != &glyphTombstone && cached->width <= 0xffff && cached->height <= 0xffff) glyphs[count++] = cached;
+        }
+    }
+
+    // save each glyph size to its own file
+    qsort(glyphs, count, sizeof(*glyphs), CompareDiskCacheGlyphsWithKerning);
+    for (int start = 0, end; start < count; start = end) {
+        int glyphSize = (int) ((glyphs[start]->key >> 8) & 0xffffff);
+        for (end = start + 1; end < count && (int) ((glyphs[end]->key >> 8) & 0xffffff) == glyphSize; end++);
+        if (!SaveDiskCacheFileWithKerning(cache, glyphSize, glyphs + start, end - start)) saved = false;
+    }
+    LeaveGlyphCacheWithKerning(cache, reader);
+    RL_FREE(glyphs);
+
+    return saved;
+}
+
+bool SetFontWithKerningSharedCache(FontWithKerning font, const char *name, size_t size)
+{
+    // glyphs are found by the font data hash, & the segment stays mapped while cached glyphs may point into it
+    if (font.cache == NULL || font.cache->shared != NULL || font.cache->face->hash == 0 || name == NULL) return false;
+
+    if (size > 0xffff0000) size = 0xffff0000; // glyphs are found by 32 bit offsets
+    size_t mappedSize = 0;
+    unsigned char *data = MapSharedMemoryWithKerning(name, size, &mappedSize);
+    if (data == NULL || mappedSize < 65536) {
+        TraceLog(LOG_WARNING, "FONT: Unable to open shared cache %s", name);
+        UnmapFileWithKerning(data, mappedSize);
+        return false;
+    }
+
+    // the first process to map the segment sets up its glyph table, which is already zero - the others wait for it. While
+    // it is set up the state holds an odd token, & if it stays the same past the timeout (the process setting it up died)
+    // a waiting process swaps in the next token & sets the segment up itself, so only one of them takes it over.
+    SharedCacheHeaderWithKerning *header = (SharedCacheHeaderWithKerning *) data;
+    unsigned int state = 0;
+    unsigned int token = 1;
+    bool setup = atomic_compare_exchange_strong_explicit(&header->state, &state, token, memory_order_acquire, memory_order_acquire);
+    unsigned long long deadline = GetNanosecondsWithKerning() + RLTEXTKERNER_SHARED_CACHE_TIMEOUT;
+    while (setup || (state != RLTEXTKERNER_SHARED_CACHE_MAGIC && (state & 1))) {
+        if (setup) {
+            mappedSize = mappedSize > 0xffff0000 ? 0xffff0000 : mappedSize;
+            header->size = (unsigned int) mappedSize;
+            header->capacity = 64;
+            while (header->capacity * 2 <= mappedSize / 128) header->capacity *= 2; // a slot for every 128 bytes, as glyphs are small
+            atomic_store_explicit(&header->used, (sizeof(*header) + header->capacity * sizeof(atomic_uint) + 7) & ~7u, memory_order_relaxed);
+            // if another process took over meanwhile, wait for it instead
+            state = token;
+            setup = false;
+            if (atomic_compare_exchange_strong_explicit(&header->state, &state, RLTEXTKERNER_SHARED_CACHE_MAGIC, memory_order_release, memory_order_acquire)) {
+                state = RLTEXTKERNER_SHARED_CACHE_MAGIC;
+            }
+            continue;
+        }
+
+        SleepMillisecondWithKerning();
+        unsigned int seen = state;
+        state = atomic_load_explicit(&header->state, memory_order_acquire);
+        unsigned long long now = GetNanosecondsWithKerning();
+        if (state != seen) {
+            deadline = now + RLTEXTKERNER_SHARED_CACHE_TIMEOUT;
+        } else if (now > deadline) {
+            token = state + 2 != RLTEXTKERNER_SHARED_CACHE_MAGIC ? state + 2 : state + 4;
+            setup = atomic_compare_exchange_strong_explicit(&header->state, &state, token, memory_order_acquire, memory_order_acquire);
+            if (setup) TraceLog(LOG_WARNING, "FONT: Shared cache %s was left half set up, setting it up again", name);
+            deadline = now + RLTEXTKERNER_SHARED_CACHE_TIMEOUT;
+        }
+    }
+    if (state != RLTEXTKERNER_SHARED_CACHE_MAGIC || header->size > mappedSize) {
+        TraceLog(LOG_WARNING, "FONT: Shared cache %s is not compatible", name);
+        UnmapFileWithKerning(data, mappedSize);
+        return false;
+    }
+
+    font.cache->shared = data;
+    font.cache->sharedSize = mappedSize;
+
+    return true;
+}
+
+void RemoveKernSharedCache(const char *name)
+{
+#if !defined(_WIN32)
+    shm_unlink(name); // Windows removes the mapping once the last process using it closes it
+#else
+    (void) name;
+#endif
+}
+
+// find a glyph added to the shared cache by any process, returns NULL if it isn't there
+static const SharedGlyphWithKerning *FindSharedGlyphWithKerning(const GlyphCacheWithKerning *cache, unsigned long long key, int source)
+{
+    SharedCacheHeaderWithKerning *header = (SharedCacheHeaderWithKerning *) cache->shared;
+    atomic_uint *slots = (atomic_uint *) (header + 1);
+    unsigned int mask = header->capacity - 1;
+    unsigned long long fontHash = cache->face->hash;
+    unsigned int slot = (unsigned int) HashCachedGlyphKeyWithKerning(key ^ fontHash) & mask;
+
+    for (int probe = 0; probe < RLTEXTKERNER_SHARED_CACHE_PROBES; probe++, slot = (slot + 1) & mask) {
+        unsigned int offset = atomic_load_explicit(&slots[slot], memory_order_acquire);
+        if (offset == 0 || offset > header->size - sizeof(SharedGlyphWithKerning)) return NULL;
+        const SharedGlyphWithKerning *glyph = (const SharedGlyphWithKerning *) (cache->shared + offset);
+        if (glyph->key == key && glyph->fontHash == fontHash && glyph->source == source) return glyph;
+    }
+
+    return NULL;
+}
+
+// allocate a glyph in the shared cache for rasterizing into, returns NULL if the shared cache is full
+static SharedGlyphWithKerning *AllocSharedGlyphWithKerning(const GlyphCacheWithKerning *cache, unsigned long long key, int source, int width, int height, int offsetY)
+{
+    SharedCacheHeaderWithKerning *header = (SharedCacheHeaderWithKerning *) cache->shared;
+    if (width > 0xffff || height > 0xffff) return NULL;
+    size_t size = (sizeof(SharedGlyphWithKerning) + (size_t) width * height + 7) & ~(size_t) 7;
+    if (size > header->size || atomic_load_explicit(&header->used, memory_order_relaxed) > header->size - size) return NULL;
+    unsigned int offset = atomic_fetch_add_explicit(&header->used, (unsigned int) size, memory_order_relaxed);
+    if (offset > header->size - size) return NULL; // another process took the last of the space
+
+    SharedGlyphWithKerning *glyph = (SharedGlyphWithKerning *) (cache->shared + offset);
+    *glyph = (SharedGlyphWithKerning){ cache->face->hash, key, source, offsetY, (unsigned short) width, (unsigned short) height, 0 };
+
+    return glyph;
+}
+
+// add a glyph rasterized into the shared cache to its table, returns the glyph to use - the glyph added by another
+// process if it added the same glyph first, or the glyph itself (only used by this process if the table is too full)
+static const SharedGlyphWithKerning *AddSharedGlyphWithKerning(const GlyphCacheWithKerning *cache, const SharedGlyphWithKerning *glyph)
+{
+    SharedCacheHeaderWithKerning *header = (SharedCacheHeaderWithKerning *) cache->shared;
+    atomic_uint *slots = (atomic_uint *) (header + 1);
+    unsigned int mask = header->capacity - 1;
+    unsigned int slot = (unsigned int) HashCachedGlyphKeyWithKerning(glyph->key ^ glyph->fontHash) & mask;
+    unsigned int offset = (unsigned int) ((const unsigned char *) glyph - cache->shared);
+
+    for (int probe = 0; probe < RLTEXTKERNER_SHARED_CACHE_PROBES; probe++, slot = (slot + 1) & mask) {
+        unsigned int other = 0;
+        if (atomic_compare_exchange_strong_explicit(&slots[slot], &other, offset, memory_order_release, memory_order_acquire)) return glyph;
+        if (other > header->size - sizeof(SharedGlyphWithKerning)) break;
+        const SharedGlyphWithKerning *added = (const SharedGlyphWithKerning *) (cache->shared + other);
+        if (added->key == glyph->key && added->fontHash == glyph->fontHash && added->source == glyph->source) return added;
+    }
+
+    return glyph;
+}
+
+// render the bitmap for a codepoint's glyph at the glyph size (KernMetricsWithKerning glyphSize) & subpixel phase into the
+// font glyph cache, after a miss
+static CachedGlyphWithKerning *LoadCachedGlyphWithKerning(FontWithKerning font, int codepoint, int glyphIndex, int glyphSize, float fontScale, int phase)
+{
+    unsigned long long key = GetCachedGlyphKeyWithKerning(glyphIndex, glyphSize, phase);
+    CachedGlyphWithKerning *cached;
+    RLTEXTKERNER_STAT(FontWithKerningStats stats = { .cacheMisses = 1 });
+    RLTEXTKERNER_STAT(unsigned long long start = GetNanosecondsWithKerning());
+
+    // use the bitmap straight from the disk cache file if it was saved there
+    const DiskCacheFileWithKerning *file = font.cache->diskCache != NULL && font.cache->face->hash != 0 ? GetDiskCacheFileWithKerning(font.cache, glyphSize) : NULL;
+    const DiskCacheGlyphWithKerning *saved = file != NULL ? FindDiskCacheGlyphWithKerning(file, GetDiskCacheKeyWithKerning(key)) : NULL;
+    if (saved != NULL) {
+        GlyphCacheShardWithKerning *shard = GetGlyphCacheShardWithKerning(font.cache, key);
+        LockMutexWithKerning(&shard->lock);
+        cached = AllocCachedGlyphWithKerning(font.cache, shard, sizeof(*cached));
+        UnlockMutexWithKerning(&shard->lock);
+        if (cached == NULL) return NULL;
+        cached->key = key;
+        cached->width = saved->width;
+        cached->height = saved->height;
+        cached->offsetY = saved->offsetY;
+        cached->data = (unsigned char *) file->data + saved->offset;
+        RLTEXTKERNER_STAT(stats.bytesAllocated = sizeof(*cached));
+        RLTEXTKERNER_STAT(stats.boundingBoxTime = GetNanosecondsWithKerning() - start);
+        RLTEXTKERNER_STAT(AddFontStatsWithKerning(font.cache, &stats));
+
+        return AddCachedGlyphWithKerning(font.cache, cached);
+    }
+
+    // or from the shared cache if another process (or this one, for another copy of the font data) rasterized it
+    int source = font.cache->shared != NULL ? GetGlyphSourceWithKerning(font.cache, glyphSize) : 0;
+    const SharedGlyphWithKerning *shared = font.cache->shared != NULL ? FindSharedGlyphWithKerning(font.cache, key, source) : NULL;
+    if (shared != NULL) {
+        GlyphCacheShardWithKerning *shard = GetGlyphCacheShardWithKerning(font.cache, key);
+        LockMutexWithKerning(&shard->lock);
+        cached = AllocCachedGlyphWithKerning(font.cache, shard, sizeof(*cached));
+        UnlockMutexWithKerning(&shard->lock);
+        if (cached == NULL) return NULL;
+        cached->key = key;
+        cached->width = shared->width;
+        cached->height = shared->height;
+        cached->offsetY = shared->offsetY;
+        cached->data = (unsigned char *) (shared + 1);
+        RLTEXTKERNER_STAT(stats.bytesAllocated = sizeof(*cached));
+        RLTEXTKERNER_STAT(stats.boundingBoxTime = GetNanosecondsWithKerning() - start);
+        RLTEXTKERNER_STAT(AddFontStatsWithKerning(font.cache, &stats));
+
+        return AddCachedGlyphWithKerning(font.cache, cached);
+    }
+
+    // measure the glyph from its cached outline, which is decoded here the first time the glyph is rasterized
+    int cX1, cY1, cX2, cY2;
+    float shiftX = (float) phase / RLTEXTKERNER_SUBPIXEL_PHASES;
+    const GlyphOutlineWithKerning *outline = GetGlyphOutlineWithKerning(font.cache->face, glyphIndex);
+    if (outline != NULL) {
+        GetGlyphOutlineBoxWithKerning(outline, fontScale, shiftX, &cX1, &cY1, &cX2, &cY2);
+    } else {
+        stbtt_GetGlyphBitmapBoxSubpixel(font.info, glyphIndex, fontScale, fontScale, shiftX, 0, &cX1, &cY1, &cX2, &cY2);
+    }
+    int glyphWidth = cX2 - cX1;
+    int glyphHeight = cY2 - cY1;
+    RLTEXTKERNER_STAT(stats.boundingBoxTime = GetNanosecondsWithKerning() - start);
+
+    // use the image for the font size in the glyph if it was pre-rendered (pre-rendered images are not shifted)
+    unsigned char *image = NULL;
+    const SdfAtlasWithKerning *sdf = &font.cache->sdf;
+    bool useSdf = sdf->rects != NULL && glyphSize * 2 >= sdf->fontSize * RLTEXTKERNER_SIZE_UNITS;
+    int glyph = (phase == 0 && font.cache->imageSizeCount > 0) || useSdf ? FindGlyphWithKerning(font, codepoint) : -1;
+    for (int i=0; glyph >= 0 && phase == 0 && i < font.cache->imageSizeCount; i++) {
+        const Image *glyphImage = &font.cache->images[glyph * font.cache->imageSizeCount + i];
+        if (font.cache->imageSizes[i] * RLTEXTKERNER_SIZE_UNITS == glyphSize && glyphImage->width == glyphWidth && glyphImage->height == glyphHeight) {
+            image = glyphImage->data;
+            break;
+        }
+    }
+
+    // rasterize straight into the shared cache if there is one with room left, otherwise into the glyph cache
+    SharedGlyphWithKerning *sharedGlyph = NULL;
+    if (font.cache->shared != NULL && image == NULL && glyphWidth > 0 && glyphHeight > 0) {
+        sharedGlyph = AllocSharedGlyphWithKerning(font.cache, key, source, glyphWidth, glyphHeight, cY1);
+    }
+    size_t size = sizeof(*cached) + (image != NULL || sharedGlyph != NULL ? 0 : glyphWidth * glyphHeight);
+    GlyphCacheShardWithKerning *shard = GetGlyphCacheShardWithKerning(font.cache, key);
+    LockMutexWithKerning(&shard->lock);
+    cached = AllocCachedGlyphWithKerning(font.cache, shard, size);
+    UnlockMutexWithKerning(&shard->lock);
+    if (cached == NULL) return NULL;
+    RLTEXTKERNER_STAT(stats.bytesAllocated = size);
+    cached->key = key;
+    cached->width = glyphWidth;
+    cached->height = glyphHeight;
+    cached->offsetY = cY1;
+    if (image) {
+        cached->data = image;
+    } else {
+        cached->data = sharedGlyph != NULL ? (unsigned char *) (sharedGlyph + 1) : (unsigned char *) (cached + 1);
+        if (glyphWidth > 0 && glyphHeight > 0) {
+            RLTEXTKERNER_STAT(start = GetNanosecondsWithKerning());
+            RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_RASTERIZE, 'B', 0, glyphSize / RLTEXTKERNER_SIZE_UNITS, 0, 0));
+            BeginKernArenaWithKerning();
+            if (useSdf && glyph >= 0 && sdf->rects[glyph * 6 + 2] > 0) {
+                DrawSdfGlyphWithKerning(sdf, glyph, cached->data, glyphWidth, glyphHeight, fontScale, shiftX, cX1, cY1);
+            } else if (outline != NULL) {
+                RasterizeGlyphOutlineWithKerning(outline, cached->data, glyphWidth, glyphHeight, fontScale, shiftX, cX1, cY1);
+            } else {
+                stbtt_MakeGlyphBitmapSubpixel(font.info, cached->data, glyphWidth, glyphHeight, glyphWidth, fontScale, fontScale, shiftX, 0, glyphIndex);
+            }
+            EndKernArenaWithKerning();
+            RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_RASTERIZE, 'E', 0, glyphSize / RLTEXTKERNER_SIZE_UNITS, 1, 0));
+            RLTEXTKERNER_STAT(stats.rasterTime = GetNanosecondsWithKerning() - start);
+            RLTEXTKERNER_STAT(stats.rasterizations = 1);
+        }
+        if (sharedGlyph != NULL) cached->data = (unsigned char *) (AddSharedGlyphWithKerning(font.cache, sharedGlyph) + 1);
+    }
+
+    // misses are rare once the cache is warm, so they are added to the font stats straight away
+    RLTEXTKERNER_STAT(AddFontStatsWithKerning(font.cache, &stats));
+
+    return AddCachedGlyphWithKerning(font.cache, cached);
+}
+
+#if defined(RLTEXTKERNER_STATS)
+// add the time since start to a stats timer, returning the current time so it can start the next timer
+static unsigned long long AddStatTimeWithKerning(unsigned long long *time, unsigned long long start)
+{
+    unsigned long long now = GetNanosecondsWithKerning();
+    *time += now - start;
+
+    return now;
+}
+#endif
+
+// get glyph from font, gathered from the font glyph arrays - index will be 0 if invalid
+GlyphWithKerning GetGlyphWithKerning(FontWithKerning font, int codepoint)
+{
+    int i = FindGlyphWithKerning(font, codepoint);
+    if (i < 0) return (GlyphWithKerning){ 0 };
+
+    int imageCount = font.cache != NULL && font.cache->images != NULL ? font.cache->imageSizeCount : 0;
+    return (GlyphWithKerning){ .index = font.glyphIndices[i], .value = font.codepoints[i], .advanceX = font.advances[i],
+                               .lsb = font.bearings[i], .imageCount = imageCount,
+                               .images = imageCount > 0 ? font.cache->images + i * imageCount : NULL };
+}
+
+void SetFontWithKerningCacheLimit(FontWithKerning font, size_t limit)
+{
+    if (font.cache == NULL) return;
+
+    font.cache->limit = limit;
+    for (int i = 0; i < RLTEXTKERNER_CACHE_SHARDS; i++) {
+        GlyphCacheShardWithKerning *shard = &font.cache->shards[i];
+        LockMutexWithKerning(&shard->lock);
+        if (limit > 0) EvictCachedGlyphsWithKerning(font.cache, shard, 0);
+        CompactGlyphCacheShardWithKerning(font.cache, shard);
+        UnlockMutexWithKerning(&shard->lock);
+    }
+}
+
+void SetFontWithKerningSizeStep(FontWithKerning font, float step)
+{
+    if (font.cache == NULL) return;
+
+    int sizeStep = (int) roundf(step * RLTEXTKERNER_SIZE_UNITS);
+    font.cache->sizeStep = sizeStep > 0 ? sizeStep : 1;
+}
+
+// find the glyph for a codepoint in the font, or in the first of its fallback fonts that has one (glyphFont is set to
+// 0 for the font itself, or the fallback index + 1) - returns 0 for the missing glyph if none of them has it
+static int FindChainGlyphWithKerning(FontWithKerning font, int codepoint, int *glyphFont)
+{
+    int glyphIndex = FindFaceGlyphWithKerning(font.cache->face, codepoint);
+    *glyphFont = 0;
+    for (int j = 0; glyphIndex == 0 && codepoint != '\n' && j < font.cache->fallbackCount; j++) {
+        const FontFaceWithKerning *fallback = font.cache->fallbacks[j].cache->face;
+        if (HasFaceGlyphWithKerning(fallback, codepoint)) {
+            glyphIndex = FindFaceGlyphWithKerning(fallback, codepoint);
+            *glyphFont = j + 1;
+        }
+    }
+
+    return glyphIndex;
+}
+
+// add pins to the cached glyphs for the text at each subpixel phase it may be drawn at, caching them first if pinning -
+// glyphs are pinned in the font they are drawn from, which may be one of its fallbacks
+static void PinTextGlyphsWithKerning(FontWithKerning font, const char *text, float fontSize, int subpixel, int pins)
+{
+    KernMetricsWithKerning metrics[1 + RLTEXTKERNER_MAX_FALLBACKS] = { GetKernMetricsWithKerning(font, fontSize) };
+    int phaseCount = subpixel ? RLTEXTKERNER_SUBPIXEL_PHASES : 1;
+
+    for (int i = 0, size; text[i] != '\0'; i += size) {
+        int codepoint = GetCodepointWithKerning(text + i, &size);
+        if (codepoint == '\n' || codepoint == ' ' || codepoint == '\t') continue;
+        int glyphFont = 0;
+        int glyphIndex = FindChainGlyphWithKerning(font, codepoint, &glyphFont);
+        FontWithKerning pinFont = glyphFont > 0 ? font.cache->fallbacks[glyphFont - 1] : font;
+        if (metrics[glyphFont].fontScale == 0) metrics[glyphFont] = GetKernMetricsWithKerning(pinFont, fontSize);
+
+        for (int phase = 0; phase < phaseCount; phase++) {
+            unsigned long long key = GetCachedGlyphKeyWithKerning(glyphIndex, metrics[glyphFont].glyphSize, phase);
+            // the glyph may be evicted again before it is pinned when the cache is full, so try twice
+            for (int attempt = 0; !PinCachedGlyphWithKerning(pinFont.cache, key, pins) && pins > 0 && attempt < 2; attempt++) {
+                if (LoadCachedGlyphWithKerning(pinFont, codepoint, glyphIndex, metrics[glyphFont].glyphSize, metrics[glyphFont].glyphScale, phase) == NULL) break;
+            }
+        }
+    }
+}
+
+void PinFontWithKerningText(FontWithKerning font, const char *text, float fontSize, int subpixel)
+{
+    PinTextGlyphsWithKerning(font, text, fontSize, subpixel, 1);
+}
+
+void UnpinFontWithKerningText(FontWithKerning font, const char *text, float fontSize, int subpixel)
+{
+    PinTextGlyphsWithKerning(font, text, fontSize, subpixel, -1);
+}
+
+void SetFontWithKerningProfileRecording(FontWithKerning font, bool record)
+{
+    if (font.cache == NULL) return;
+
+    if (record && font.cache->profile == NULL) {
+        font.cache->profile = RL_CALLOC(1, sizeof(*font.cache->profile));
+        if (font.cache->profile == NULL) TraceLog(LOG_WARNING, "FONT: Error allocating memory for glyph profile");
+    }
+    font.cache->recording = record && font.cache->profile != NULL;
+}
+
+// count a glyph drawn while recording - glyphs beyond RLTEXTKERNER_PROFILE_GLYPHS aren't counted
+static void RecordProfileGlyphWithKerning(GlyphProfileWithKerning *profile, int codepoint, int glyphSize, int phase)
+{
+    unsigned long long key = ((unsigned long long) (unsigned int) codepoint << 32 | (unsigned long long) glyphSize << 8 | (unsigned int) phase) + 1;
+    unsigned int mask = RLTEXTKERNER_PROFILE_GLYPHS - 1;
+    unsigned int slot = (unsigned int) HashCachedGlyphKeyWithKerning(key) & mask;
+    for (unsigned int probe = 0; probe <= mask; probe++, slot = (slot + 1) & mask) {
+        unsigned long long stored = atomic_load_explicit(&profile->keys[slot], memory_order_relaxed);
+        if (stored == 0 && atomic_compare_exchange_strong_explicit(&profile->keys[slot], &stored, key, memory_order_relaxed, memory_order_relaxed)) {
+            stored = key;
+        }
+        if (stored == key) {
+            atomic_fetch_add_explicit(&profile->counts[slot], 1, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+// order profile glyphs most used first
+static int CompareProfileGlyphsWithKerning(const void *a, const void *b)
+{
+    const ProfileGlyphWithKerning *first = a, *second = b;
+
+    return first->count > second->count ? -1 : (first->count < second->count ? 1 : 0);
+}
+
+bool ExportFontWithKerningProfile(FontWithKerning font, const char *fileName)
+{
+    if (font.cache == NULL || font.cache->profile == NULL) return false;
+
+    GlyphProfileWithKerning *profile = font.cache->profile;
+    ProfileGlyphWithKerning *glyphs = RL_MALLOC(RLTEXTKERNER_PROFILE_GLYPHS * sizeof(*glyphs));
+    if (glyphs == NULL) return false;
+    int count = 0;
+    for (int i = 0; i < RLTEXTKERNER_PROFILE_GLYPHS; i++) {
+        unsigned long long key = atomic_load_explicit(&profile->keys[i], memory_order_relaxed);
+        if (key-- == 0) continue;
+        glyphs[count++] = (ProfileGlyphWithKerning){ (int) (key >> 32), (float) ((key >> 8) & 0xffffff) / RLTEXTKERNER_SIZE_UNITS, (int) (key & 0xff),
+                                                     atomic_load_explicit(&profile->counts[i], memory_order_relaxed) };
+    }
+    qsort(glyphs, count, sizeof(*glyphs), CompareProfileGlyphsWithKerning);
+
+    // one glyph per line, so profiles from several runs are easy to compare & merge
+    FILE *file = fopen(fileName, "w");
+    bool success = file != NULL;
+    if (success) {
+        fprintf(file, "# rltextkerner glyph profile: codepoint, font size, subpixel phase (of %d), times drawn\n", RLTEXTKERNER_SUBPIXEL_PHASES);
+        for (int i = 0; i < count; i++) fprintf(file, "%d %g %d %llu\n", glyphs[i].codepoint, glyphs[i].fontSize, glyphs[i].phase, glyphs[i].count);
+        success = fclose(file) == 0;
+    }
+    if (success) TraceLog(LOG_INFO, "FONT: Exported glyph profile with %d glyphs to %s", count, fileName);
+    else TraceLog(LOG_WARNING, "FONT: Unable to export glyph profile to %s", fileName);
+    RL_FREE(glyphs);
+
+    return success;
+}
+
+static void PrewarmProcWithKerning(void *arg)
+{
+    PrewarmWithKerning *prewarm = arg;
+    FontWithKerning font = prewarm->font;
+
+    for (int i = 0; i < prewarm->glyphCount && !atomic_load_explicit(&prewarm->stop, memory_order_relaxed); i++) {
+        const ProfileGlyphWithKerning *glyph = &prewarm->glyphs[i];
+        int glyphIndex = FindFaceGlyphWithKerning(font.cache->face, glyph->codepoint);
+        if (glyphIndex == 0) continue; // drawn by a fallback font, which has its own profile
+        KernMetricsWithKerning metrics = GetKernMetricsWithKerning(font, glyph->fontSize);
+        unsigned long long key = GetCachedGlyphKeyWithKerning(glyphIndex, metrics.glyphSize, glyph->phase);
+        int reader = EnterGlyphCacheWithKerning(font.cache);
+        bool cached = FindCachedGlyphWithKerning(font.cache, key) != NULL;
+        LeaveGlyphCacheWithKerning(font.cache, reader);
+        if (!cached) LoadCachedGlyphWithKerning(font, glyph->codepoint, glyphIndex, metrics.glyphSize, metrics.glyphScale, glyph->phase);
+    }
+    atomic_store_explicit(&prewarm->done, true, memory_order_release);
+}
+
+bool PrewarmFontWithKerning(FontWithKerning font, const char *fileName, int maxGlyphs)
+{
+    if (font.cache == NULL) return false;
+    int dataSize = 0;
+    unsigned char *data = LoadFileData(fileName, &dataSize);
+    if (data == NULL) return false;
+
+    // read the profile lines, skipping comments & glyphs for other subpixel settings
+    int capacity = 1;
+    for (int i = 0; i < dataSize; i++) capacity += data[i] == '\n';
+    PrewarmWithKerning *prewarm = RL_CALLOC(1, sizeof(*prewarm));
+    ProfileGlyphWithKerning *glyphs = RL_MALLOC(capacity * sizeof(*glyphs));
+    char *text = RL_MALLOC(dataSize + 1);
+    if (prewarm == NULL || glyphs == NULL || text == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for prewarming %s", fileName);
+        RL_FREE(prewarm);
+        RL_FREE(glyphs);
+        RL_FREE(text);
+        UnloadFileData(data);
+        return false;
+    }
+    prewarm->glyphs = glyphs;
+    memcpy(text, data, dataSize);
+    text[dataSize] = '\0';
+    UnloadFileData(data);
+    for (char *line = text, *next; line != NULL && *line != '\0'; line = next) {
+        next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+        ProfileGlyphWithKerning glyph = { 0 };
+        if (line[0] == '#' || sscanf(line, "%d %f %d %llu", &glyph.codepoint, &glyph.fontSize, &glyph.phase, &glyph.count) != 4) continue;
+        if (glyph.phase < 0 || glyph.phase >= RLTEXTKERNER_SUBPIXEL_PHASES || glyph.fontSize <= 0) continue;
+        prewarm->glyphs[prewarm->glyphCount++] = glyph;
+    }
+    RL_FREE(text);
+    qsort(prewarm->glyphs, prewarm->glyphCount, sizeof(*prewarm->glyphs), CompareProfileGlyphsWithKerning);
+    if (maxGlyphs > 0 && prewarm->glyphCount > maxGlyphs) prewarm->glyphCount = maxGlyphs;
+
+    // render on a background thread, or right away if threads aren't available
+    StopPrewarmWithKerning(font.cache);
+    prewarm->font = font;
+    atomic_init(&prewarm->stop, false);
+    atomic_init(&prewarm->done, false);
+    font.cache->prewarm = prewarm;
+    prewarm->started = StartWorkerWithKerning(&prewarm->worker, PrewarmProcWithKerning, prewarm);
+    if (!prewarm->started) PrewarmProcWithKerning(prewarm);
+
+    return true;
+}
+
+bool IsFontWithKerningPrewarming(FontWithKerning font)
+{
+    return font.cache != NULL && font.cache->prewarm != NULL && !atomic_load_explicit(&font.cache->prewarm->done, memory_order_acquire);
+}
+
+FontWithKerning LoadFontWithKerningFromCorpus(const char *fileName, const char **texts, int textCount, const int *fontSizes, int fontSizeCount)
+{
+    FontWithKerning font = { 0 };
+    if (fontSizeCount <= 0) {
+        TraceLog(LOG_WARNING, "FONT: Error loading font (%s) from corpus - no font sizes given", fileName);
+        return font;
+    }
+
+    // mark each codepoint of the corpus in a bitset, which then lists them in order without duplicates
+    unsigned long long *used = RL_CALLOC(0x110000 / 64, sizeof(*used));
+    if (used == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for font corpus");
+        return font;
+    }
+    int codepointCount = 0;
+    for (int i = 0; i < textCount; i++) {
+        int size = 0;
+        for (const char *text = texts[i]; *text != '\0'; text += size) {
+            int codepoint = GetCodepointWithKerning(text, &size);
+            if (codepoint < 32 || codepoint >= 0x110000 || (used[codepoint / 64] >> (codepoint % 64) & 1)) continue; // control codes have no glyph
+            used[codepoint / 64] |= 1ULL << (codepoint % 64);
+            ++codepointCount;
+        }
+    }
+    int *codepoints = RL_MALLOC((codepointCount > 0 ? codepointCount : 1) * sizeof(*codepoints));
+    if (codepoints == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for font corpus");
+        RL_FREE(used);
+        return font;
+    }
+    int count = 0;
+    for (int i = 0; i < 0x110000 / 64; i++) {
+        for (unsigned long long bits = used[i]; bits != 0; bits &= bits - 1) {
+            int bit = 0;
+            while (!(bits >> bit & 1)) ++bit;
+            codepoints[count++] = i * 64 + bit;
+        }
+    }
+    RL_FREE(used);
+
+    // an empty corpus loads the default glyphs, like an empty codepoint list
+    font = LoadFontWithKerningEx(fileName, fontSizes[0], codepointCount > 0 ? codepoints : NULL, codepointCount);
+    RL_FREE(codepoints);
+    if (font.info == NULL) return font;
+
+    UpdateFontWithKerningPairs(font, texts, textCount);
+    if (fontSizeCount > 1) UpdateFontWithKerningBitmapsEx(&font, fontSizes + 1, fontSizeCount - 1, fontThreadCount);
+    TraceLog(LOG_INFO, "FONT: Font corpus loaded (%i codepoints, %i sizes)", font.glyphCount, fontSizeCount);
+
+    return font;
+}
+
+void UpdateFontWithKerningPairs(FontWithKerning font, const char **texts, int textCount)
+{
+    if (font.info == NULL || font.cache == NULL) return;
+
+    GlyphCacheWithKerning *cache = font.cache;
+    RL_FREE(cache->kernPairs);
+    cache->kernPairs = NULL;
+    cache->kernAdvances = NULL;
+    cache->kernPairCapacity = 0;
+
+    // collect the pairs of glyphs next to each other into a table kept at most half full, with room for their kerning
+    unsigned int *pairs = NULL;
+    int capacity = 0;
+    int pairCount = 0;
+    for (int i = 0; i < textCount; i++) {
+        int glyphIndex = 0;
+        int size = 0;
+        for (const char *text = texts[i]; *text != '\0'; text += size) {
+            int codepoint = GetCodepointWithKerning(text, &size);
+            // the layout doesn't kern after whitespace, & pairs with glyphs the font doesn't have go to its fallbacks
+            int nextGlyphIndex = FindFaceGlyphWithKerning(cache->face, codepoint);
+            if (glyphIndex > 0 && nextGlyphIndex > 0) {
+                if ((pairCount + 1) * 2 > capacity) {
+                    int grownCapacity = capacity > 0 ? capacity * 2 : 256;
+                    unsigned int *grown = RL_CALLOC(grownCapacity, sizeof(*pairs) + sizeof(*cache->kernAdvances));
+                    if (grown == NULL) {
+                        TraceLog(LOG_WARNING, "FONT: Error allocating memory for kerning pairs");
+                        RL_FREE(pairs);
+                        return;
+                    }
+                    for (int j = 0; j < capacity; j++) {
+                        if (pairs[j] != 0) grown[FindKernPairWithKerning(grown, grownCapacity, pairs[j])] = pairs[j];
+                    }
+                    RL_FREE(pairs);
+                    pairs = grown;
+                    capacity = grownCapacity;
+                }
+                unsigned int pair = (unsigned int) glyphIndex << 16 | (unsigned int) nextGlyphIndex;
+                int slot = FindKernPairWithKerning(pairs, capacity, pair);
+                if (pairs[slot] == 0) {
+                    pairs[slot] = pair;
+                    ++pairCount;
+                }
+            }
+            glyphIndex = codepoint == ' ' || codepoint == '\t' || codepoint == '\n' ? 0 : nextGlyphIndex;
+        }
+    }
+    if (pairs == NULL) return;
+
+    int *advances = (int *) (pairs + capacity);
+    for (int i = 0; i < capacity; i++) {
+        if (pairs[i] != 0) advances[i] = stbtt_GetGlyphKernAdvance(font.info, pairs[i] >> 16, pairs[i] & 0xffff);
+    }
+    cache->kernPairs = pairs;
+    cache->kernAdvances = advances;
+    cache->kernPairCapacity = capacity;
+    TraceLog(LOG_INFO, "FONT: Kerning looked up for %i glyph pairs", pairCount);
+}
+
+Image KernCodepoints(const int *codepoints, int codepointsCount, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel)
+{
+    return KernCodepointsWithScratch(codepoints, codepointsCount, font, GetKernMetricsWithKerning(font, fontSize), maxWidth, maxHeight, wrap, subpixel, &threadScratch);
+}
+
+// resolve each codepoint to a glyph of the font, or of the first fallback font that has one, & its metrics into the
+// scratch memory - layout goes back over words it wraps & looks at the next glyph for kerning, so each codepoint is only
+// looked up once
+static bool ResolveGlyphsWithKerning(FontWithKerning font, const int *codepoints, int codepointsCount, KernScratchWithKerning *scratch)
+{
+    if (codepointsCount > scratch->glyphCapacity) {
+        int *glyphIndices = RL_REALLOC(scratch->glyphIndices, codepointsCount * sizeof(*glyphIndices));
+        if (glyphIndices != NULL) scratch->glyphIndices = glyphIndices;
+        unsigned char *glyphFonts = RL_REALLOC(scratch->glyphFonts, codepointsCount * sizeof(*glyphFonts));
+        if (glyphFonts != NULL) scratch->glyphFonts = glyphFonts;
+        int *advances = RL_REALLOC(scratch->advances, codepointsCount * sizeof(*advances));
+        if (advances != NULL) scratch->advances = advances;
+        int *bearings = RL_REALLOC(scratch->bearings, codepointsCount * sizeof(*bearings));
+        if (bearings != NULL) scratch->bearings = bearings;
+        if (glyphIndices == NULL || glyphFonts == NULL || advances == NULL || bearings == NULL) return false;
+        scratch->glyphCapacity = codepointsCount;
+    }
+
+    for (int i = 0; i < codepointsCount; i++) {
+        int codepoint = codepoints[i];
+        int glyphFont = 0;
+        int glyphIndex = FindChainGlyphWithKerning(font, codepoint, &glyphFont);
+        if (glyphIndex == 0) AddMissingGlyphWithKerning(font.cache, codepoint);
+        scratch->glyphIndices[i] = glyphIndex;
+        scratch->glyphFonts[i] = (unsigned char) glyphFont;
+        const FontFaceWithKerning *face = glyphFont > 0 ? font.cache->fallbacks[glyphFont - 1].cache->face : font.cache->face;
+        GetFaceHMetricsWithKerning(face, glyphIndex, &scratch->advances[i], &scratch->bearings[i]);
+    }
+
+    return true;
+}
+
+// kern codepoints using the scratch memory, which is left ready to be used for the next string
+static Image KernCodepointsWithScratch(const int *codepoints, int codepointsCount, FontWithKerning font, KernMetricsWithKerning metrics, int maxWidth, int maxHeight, int wrap, int subpixel, KernScratchWithKerning *scratch)
+{
+    assert(font.info);
+    assert(font.cache);
+    assert(maxWidth > 0);
+    assert(maxHeight > 0);
+
+    // counters for this string, added to the font stats at the end
+    RLTEXTKERNER_STAT(FontWithKerningStats stats = { .strings = 1 });
+    RLTEXTKERNER_STAT(unsigned long long start = GetNanosecondsWithKerning());
+    RLTEXTKERNER_TRACE_SPAN(int glyphsDrawn = 0, cacheMisses = 0);
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_LAYOUT, 'B', codepointsCount, metrics.fontSize, 0, 0));
+
+    // bitmap for writing the resulting image data
+    if (scratch->bitmapSize < maxWidth * maxHeight) {
+        RL_FREE(scratch->bitmap);
+        scratch->bitmap = RL_CALLOC(maxWidth * maxHeight, sizeof(unsigned char));
+        scratch->bitmapSize = scratch->bitmap ? maxWidth * maxHeight : 0;
+        if (scratch->bitmap == NULL) {
+            TraceLog(LOG_WARNING, "FONT: Error allocating memory for text bitmap");
+            RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_LAYOUT, 'E', codepointsCount, metrics.fontSize, 0, 0));
+            return (Image){ 0 };
+        }
+        RLTEXTKERNER_STAT(stats.bytesAllocated += maxWidth * maxHeight);
+    }
+    if (!ResolveGlyphsWithKerning(font, codepoints, codepointsCount, scratch)) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for text glyphs");
+        RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_LAYOUT, 'E', codepointsCount, metrics.fontSize, 0, 0));
+        return (Image){ 0 };
+    }
+    unsigned char *bitmap = scratch->bitmap;
+    int bitmapRows = 0; // rows of the bitmap that have been drawn to
+    int reader = EnterGlyphCacheWithKerning(font.cache); // keeps cached glyphs valid until they are drawn
+    RLTEXTKERNER_STAT(unsigned long long mark = GetNanosecondsWithKerning()); // each phase timer runs from the previous mark
+
+    float fontSize = metrics.fontSize;
+    int ascent = metrics.ascent;
+    int yInc = metrics.lineHeight;
+
+    // metrics of the fallback fonts at the font size, and their cache readers - set when a fallback is first drawn from
+    KernMetricsWithKerning fallbackMetrics[RLTEXTKERNER_MAX_FALLBACKS] = { 0 };
+    int fallbackReaders[RLTEXTKERNER_MAX_FALLBACKS];
+
+    float x = 0;
+    int y = 0;
+    int i = 0;
+    int lastSpaceX = 0;
+    int lastSpaceIndex = 0;
+    int imageWidth = 0;
+    while (i < codepointsCount && y + yInc < maxHeight)
+    {
+        int codepoint = codepoints[i];
+
+        // get the glyph resolved for the codepoint & the font it is drawn from
+        int glyphIndex = scratch->glyphIndices[i];
+        int fallback = scratch->glyphFonts[i] - 1;
+        FontWithKerning glyphFont = font;
+        const KernMetricsWithKerning *glyphMetrics = &metrics;
+        if (fallback >= 0) {
+            glyphFont = font.cache->fallbacks[fallback];
+            if (fallbackMetrics[fallback].fontScale == 0) {
+                fallbackMetrics[fallback] = GetKernMetricsWithKerning(glyphFont, fontSize);
+                fallbackReaders[fallback] = EnterGlyphCacheWithKerning(glyphFont.cache);
+            }
+            glyphMetrics = &fallbackMetrics[fallback];
+        }
+        float glyphScale = glyphMetrics->fontScale;
+        int advanceX = scratch->advances[i];
+        int lsb = scratch->bearings[i];
+        RLTEXTKERNER_STAT(++stats.glyphLookups);
+        RLTEXTKERNER_STAT(mark = AddStatTimeWithKerning(&stats.lookupTime, mark));
+
+        // handle newline characters
+        if (codepoint == '\n') {
+            // new line - first reset x to first column and advance y
+            lastSpaceX = 0;
+            lastSpaceIndex = 0;
+            x = 0;
+            y += yInc;
+        // mark word seen in current x pos
+        } else if (codepoint == ' ' || codepoint == '\t') {
+            lastSpaceX = x;
+            lastSpaceIndex = i;
+            if (x < maxWidth) x += advanceX * glyphScale; // conditional to prevent overflow
+        // draw the glyph and handle word wrapping
+        } else {
+            // add kerning & calculate x increment for this glyph
+            int kern = 0;
+            if (i < codepointsCount - 1 && scratch->glyphFonts[i + 1] == scratch->glyphFonts[i]) {
+                // lookup kerning if two characters of the same font side by side
+                kern = GetKernAdvanceWithKerning(glyphFont, glyphIndex, scratch->glyphIndices[i + 1]);
+                RLTEXTKERNER_STAT(++stats.kerningQueries);
+            }
+            RLTEXTKERNER_STAT(mark = AddStatTimeWithKerning(&stats.kerningTime, mark));
+            float xInc = kern * glyphScale + advanceX * glyphScale;
+
+            // handle word wrap
             if (ceil(x + xInc) >= maxWidth) {
                 if (wrap) {
                     if (lastSpaceX > 0) {
@@ -320,79 +4144,689 @@ Image KernCodepoints(const int *codepoints, int codepointsCount, FontWithKerning
                 }
             }
 
-            // compute the glyph dimensions & subpixel shift for the glyph
-            int cX1, cY1, cX2, cY2;
-            float subpixelShift = x - (float) floor(x);
-            stbtt_GetGlyphBitmapBoxSubpixel(font.info,
-                    glyph.index,
-                    fontScale,
-                    fontScale,
-                    subpixel ? subpixelShift : 0,
-                    0, &cX1, &cY1, &cX2, &cY2);
-
-            // calculate offset index in our destination bitmap
-            int bitmapOffset = floor(x) + roundf(glyph.lsb * fontScale) + ((y + ascent + cY1) * maxWidth);
-            x = x + xInc;
-            if (ceil(x) > imageWidth) imageWidth = ceil(x);
-
-            // find image for corresponding font size in glyph
-            int glyphWidth = cX2 - cX1;
-            int glyphHeight = cY2 - cY1;
-            unsigned char *glyphBitmap = NULL;
-            for (int i=0; i < glyph.imageCount; i++) {
-                if (glyph.images[i].width == glyphWidth && glyph.images[i].height == glyphHeight) {
-                    glyphBitmap = glyph.images[i].data;
-                    break;
+            // snap x to the nearest cached subpixel position & find the glyph bitmap for it, rendering it if needed
+            int subpixelX = subpixel ? (int) roundf(x * RLTEXTKERNER_SUBPIXEL_PHASES) : (int) floor(x) * RLTEXTKERNER_SUBPIXEL_PHASES;
+            int phase = subpixelX % RLTEXTKERNER_SUBPIXEL_PHASES;
+            CachedGlyphWithKerning *glyphBitmap = FindCachedGlyphWithKerning(glyphFont.cache, GetCachedGlyphKeyWithKerning(glyphIndex, glyphMetrics->glyphSize, phase));
+            if (glyphBitmap != NULL) {
+                if (!atomic_load_explicit(&glyphBitmap->referenced, memory_order_relaxed)) {
+                    atomic_store_explicit(&glyphBitmap->referenced, true, memory_order_relaxed);
                 }
+                RLTEXTKERNER_STAT(++stats.cacheHits);
+                RLTEXTKERNER_STAT(mark = AddStatTimeWithKerning(&stats.lookupTime, mark));
+            } else {
+                glyphBitmap = LoadCachedGlyphWithKerning(glyphFont, codepoint, glyphIndex, glyphMetrics->glyphSize, glyphMetrics->glyphScale, phase);
+                RLTEXTKERNER_TRACE_SPAN(++cacheMisses);
+                RLTEXTKERNER_STAT(mark = GetNanosecondsWithKerning()); // misses are timed by LoadCachedGlyphWithKerning
             }
+            if (glyphFont.cache->recording) RecordProfileGlyphWithKerning(glyphFont.cache->profile, codepoint, glyphMetrics->glyphSize, phase);
 
-            // if image wasn't found, generate a new one
-            int bitmapAllocated = 0;
-            if (glyphBitmap == NULL) {
-                bitmapAllocated = 1;
-                glyphBitmap = stbtt_GetGlyphBitmapSubpixel(font.info, fontScale,
-                        fontScale,
-                        subpixel ? subpixelShift : 0,
-                        0,
-                        glyph.index, NULL, NULL, NULL, NULL);
-            }
-
-            // draw the glyph onto the destination bitmap
+            // draw the glyph onto the destination bitmap, clipped to the bitmap bounds
             if (glyphBitmap) {
-                int glyphOffset = 0;
-                for (int y = 0; y < glyphHeight; y++) {
-                    for (int x = 0; x < glyphWidth; x++) {
-                        if (glyphBitmap[glyphOffset + x] != 0) {
-                            bitmap[bitmapOffset + x] = glyphBitmap[glyphOffset + x];
-                        }
+                int glyphX = subpixelX / RLTEXTKERNER_SUBPIXEL_PHASES + (int) roundf(lsb * glyphScale);
+                int glyphY = y + ascent + glyphBitmap->offsetY;
+                int startX = glyphX < 0 ? -glyphX : 0;
+                int startY = glyphY < 0 ? -glyphY : 0;
+                int endX = glyphX + glyphBitmap->width > maxWidth ? maxWidth - glyphX : glyphBitmap->width;
+                int endY = glyphY + glyphBitmap->height > maxHeight ? maxHeight - glyphY : glyphBitmap->height;
+                for (int y = startY; y < endY; y++) {
+                    unsigned char *row = bitmap + (glyphY + y) * maxWidth + glyphX;
+                    const unsigned char *glyphRow = glyphBitmap->data + y * glyphBitmap->width;
+                    for (int x = startX; x < endX; x++) {
+                        if (glyphRow[x] != 0) row[x] = glyphRow[x];
                     }
-                    bitmapOffset += maxWidth;
-                    glyphOffset += glyphWidth;
                 }
+                if (glyphY + endY > bitmapRows) bitmapRows = glyphY + endY;
+                RLTEXTKERNER_STAT(if (endX > startX && endY > startY) stats.pixelsComposited += (endX - startX) * (endY - startY));
+                RLTEXTKERNER_STAT(mark = AddStatTimeWithKerning(&stats.compositeTime, mark));
+                RLTEXTKERNER_TRACE_SPAN(++glyphsDrawn);
             } else {
-                TraceLog(LOG_WARNING, "FONT: Error generating char bitmap for codepoint: %i", glyph.value);
+                TraceLog(LOG_WARNING, "FONT: Error generating char bitmap for codepoint: %i", codepoint);
             }
 
-            if (bitmapAllocated == 1) free(glyphBitmap);
+            x = x + xInc;
+            if (ceil(x) > imageWidth) imageWidth = ceil(x);
         }
 
         ++i;
     }
+    LeaveGlyphCacheWithKerning(font.cache, reader);
+    for (int j = 0; j < font.cache->fallbackCount; j++) {
+        if (fallbackMetrics[j].fontScale != 0) LeaveGlyphCacheWithKerning(font.cache->fallbacks[j].cache, fallbackReaders[j]);
+    }
 
-    Image image = { .data = bitmap,
+    // copy the drawn part of the bitmap into an image cropped to height & width
+    int imageHeight = y + yInc >= maxHeight ? maxHeight : y + yInc;
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_COMPOSITE, 'B', 0, fontSize, 0, 0));
+    Image image = { .data = RL_MALLOC(imageWidth * imageHeight > 0 ? imageWidth * imageHeight : 1),
                     .mipmaps = 1,
                     .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE,
-                    .width = maxWidth,
-                    .height = maxHeight };
+                    .width = imageWidth,
+                    .height = imageHeight };
+    if (image.data != NULL) {
+        RLTEXTKERNER_STAT(stats.bytesAllocated += imageWidth * imageHeight > 0 ? imageWidth * imageHeight : 1);
+        for (int y = 0; y < imageHeight; y++) {
+            memcpy((unsigned char *) image.data + y * imageWidth, bitmap + y * maxWidth, imageWidth);
+        }
+    } else {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for text image");
+        image = (Image){ 0 };
+    }
 
+    // clear the bitmap for the next string
+    memset(bitmap, 0, bitmapRows * maxWidth);
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_COMPOSITE, 'E', 0, fontSize, glyphsDrawn, 0));
+    RLTEXTKERNER_TRACE_SPAN(TraceWithKerning(KERN_TRACE_LAYOUT, 'E', codepointsCount, fontSize, glyphsDrawn, cacheMisses));
+    RLTEXTKERNER_STAT(mark = AddStatTimeWithKerning(&stats.compositeTime, mark));
+    RLTEXTKERNER_STAT(stats.totalTime = mark - start);
+    RLTEXTKERNER_STAT(AddFontStatsWithKerning(font.cache, &stats));
 
-    // ensure image data is cropped to height & width
-    int imageHeight = y + yInc >= maxHeight ? maxHeight : y + yInc;
-    ImageCrop(&image, (Rectangle){ 0, 0, imageWidth, image.height = imageHeight });
+    return image;
+}
+
+// Label atlas - shelves are rows of labels stacked from the top of the image. Each shelf is split into spans along x,
+// either holding a label or free. New labels go into the free span of the shelf wasting the least height, or a new shelf
+// below the others. Removing a label frees its span (merged with free neighbors) & an empty bottom shelf is dropped.
+
+#define RLTEXTKERNER_ATLAS_PADDING 1 // pixels left between labels, so texture filtering doesn't bleed between them
+
+typedef struct LabelSpanWithKerning {
+    int x;
+    int width;
+    int label;          // label in the span, or -1 if free
+} LabelSpanWithKerning;
+
+struct LabelShelfWithKerning {
+    int y;
+    int height;
+    int spanCount;
+    LabelSpanWithKerning *spans;
+};
+
+LabelAtlasWithKerning LoadLabelAtlasWithKerning(int width, int height)
+{
+    LabelAtlasWithKerning atlas = { 0 };
+    atlas.image.data = RL_CALLOC(width * height, 1);
+    if (atlas.image.data == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for label atlas");
+        return atlas;
+    }
+    atlas.image.width = width;
+    atlas.image.height = height;
+    atlas.image.mipmaps = 1;
+    atlas.image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+    atlas.modified = 1;
+
+    return atlas;
+}
+
+void UnloadLabelAtlasWithKerning(LabelAtlasWithKerning atlas)
+{
+    for (int i = 0; i < atlas.shelfCount; i++) RL_FREE(atlas.shelves[i].spans);
+    RL_FREE(atlas.shelves);
+    RL_FREE(atlas.labels);
+    RL_FREE(atlas.image.data);
+}
+
+// insert span into shelf before index - returns 0 if out of memory
+static int InsertLabelSpanWithKerning(LabelShelfWithKerning *shelf, int index, LabelSpanWithKerning span)
+{
+    LabelSpanWithKerning *spans = RL_REALLOC(shelf->spans, (shelf->spanCount + 1) * sizeof(*spans));
+    if (spans == NULL) return 0;
+    memmove(spans + index + 1, spans + index, (shelf->spanCount - index) * sizeof(*spans));
+    spans[index] = span;
+    shelf->spans = spans;
+    ++shelf->spanCount;
+
+    return 1;
+}
+
+static void RemoveLabelSpanWithKerning(LabelShelfWithKerning *shelf, int index)
+{
+    memmove(shelf->spans + index, shelf->spans + index + 1, (shelf->spanCount - index - 1) * sizeof(*shelf->spans));
+    --shelf->spanCount;
+}
+
+// get a label id, reusing the id of a removed label if there is one - returns -1 if out of memory
+static int NewLabelAtlasLabelWithKerning(LabelAtlasWithKerning *atlas)
+{
+    for (int i = 0; i < atlas->labelCount; i++) {
+        if (atlas->labels[i].width == 0 && atlas->labels[i].height == 0) return i;
+    }
+
+    Rectangle *labels = RL_REALLOC(atlas->labels, (atlas->labelCount + 1) * sizeof(*labels));
+    if (labels == NULL) return -1;
+    atlas->labels = labels;
+
+    return atlas->labelCount++;
+}
+
+int AddLabelAtlasImage(LabelAtlasWithKerning *atlas, Image image)
+{
+    assert(image.format == PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    if (atlas->image.data == NULL) return -1;
+    if (image.width <= 0 || image.height <= 0) return KERN_LABEL_EMPTY;
+    if (image.data == NULL) return -1;
+
+    int width = image.width + RLTEXTKERNER_ATLAS_PADDING;
+    int height = image.height + RLTEXTKERNER_ATLAS_PADDING;
+    if (width > atlas->image.width) return -1;
+
+    // find the free span in the shelf wasting the least height
+    int bestShelf = -1;
+    int bestSpan = -1;
+    for (int i = 0; i < atlas->shelfCount; i++) {
+        LabelShelfWithKerning *shelf = &atlas->shelves[i];
+        if (shelf->height < height) continue;
+        if (bestShelf >= 0 && shelf->height >= atlas->shelves[bestShelf].height) continue;
+        for (int j = 0; j < shelf->spanCount; j++) {
+            if (shelf->spans[j].label < 0 && shelf->spans[j].width >= width) {
+                bestShelf = i;
+                bestSpan = j;
+                break;
+            }
+        }
+    }
+
+    // don't waste tall shelves on short labels when there is room for a new shelf below
+    int shelvesBottom = atlas->shelfCount > 0 ? atlas->shelves[atlas->shelfCount - 1].y + atlas->shelves[atlas->shelfCount - 1].height : 0;
+    int hasRoom = shelvesBottom + height <= atlas->image.height;
+    int newShelf = bestShelf < 0 || (hasRoom && atlas->shelves[bestShelf].height > height * 2);
+    if (newShelf && !hasRoom) return -1;
+
+    // the label's rectangle stays zero (free for reuse) until the label is placed
+    int label = NewLabelAtlasLabelWithKerning(atlas);
+    if (label < 0) return -1;
+    atlas->labels[label] = (Rectangle){ 0 };
+
+    if (newShelf) {
+        LabelShelfWithKerning *shelves = RL_REALLOC(atlas->shelves, (atlas->shelfCount + 1) * sizeof(*shelves));
+        if (shelves == NULL) return -1;
+        atlas->shelves = shelves;
+        LabelShelfWithKerning shelf = { .y = shelvesBottom, .height = height };
+        if (!InsertLabelSpanWithKerning(&shelf, 0, (LabelSpanWithKerning){ 0, atlas->image.width, -1 })) return -1;
+        atlas->shelves[atlas->shelfCount] = shelf;
+        bestShelf = atlas->shelfCount++;
+        bestSpan = 0;
+    }
+
+    // split the free span, keeping the rest of it free
+    LabelShelfWithKerning *shelf = &atlas->shelves[bestShelf];
+    LabelSpanWithKerning *span = &shelf->spans[bestSpan];
+    if (span->width > width) {
+        LabelSpanWithKerning rest = { span->x + width, span->width - width, -1 };
+        if (!InsertLabelSpanWithKerning(shelf, bestSpan + 1, rest)) return -1;
+        span = &shelf->spans[bestSpan];
+        span->width = width;
+    }
+    span->label = label;
+
+    // copy the image into the atlas
+    unsigned char *pixels = atlas->image.data;
+    for (int y = 0; y < image.height; y++) {
+        memcpy(pixels + (shelf->y + y) * atlas->image.width + span->x, (unsigned char *) image.data + y * image.width, image.width);
+    }
+    atlas->labels[label] = (Rectangle){ (float) span->x, (float) shelf->y, (float) image.width, (float) image.height };
+    atlas->modified = 1;
+
+    return label;
+}
+
+int AddLabelAtlasText(LabelAtlasWithKerning *atlas, const char *text, FontWithKerning font, float fontSize, int maxWidth, int wrap)
+{
+    Image image = KernTextEx(text, font, fontSize, maxWidth, atlas->image.height, wrap, 1);
+    int label = AddLabelAtlasImage(atlas, image);
+    UnloadImage(image);
+
+    return label;
+}
+
+// label image height & index, sorted by AddLabelAtlasTexts
+typedef struct LabelOrderWithKerning {
+    int height;
+    int index;
+} LabelOrderWithKerning;
+
+// order labels by descending image height, then by index so the order is stable
+static int CompareLabelHeightWithKerning(const void *a, const void *b)
+{
+    const LabelOrderWithKerning *labelA = a;
+    const LabelOrderWithKerning *labelB = b;
+    if (labelA->height != labelB->height) return labelB->height - labelA->height;
+
+    return labelA->index - labelB->index;
+}
+
+void AddLabelAtlasTexts(LabelAtlasWithKerning *atlas, const char **texts, int count, FontWithKerning font, float fontSize, int maxWidth, int wrap, int *labels)
+{
+    Image *images = RL_MALLOC(count * sizeof(*images));
+    if (images == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for label images");
+        for (int i = 0; i < count; i++) labels[i] = -1;
+        return;
+    }
+
+    KernTextBatch(texts, count, font, fontSize, maxWidth, atlas->image.height, wrap, 1, 0, images);
+
+    // pack the tallest labels first, which fills the shelves much better than packing them in order
+    LabelOrderWithKerning *order = RL_MALLOC(count * sizeof(*order));
+    if (order != NULL) {
+        for (int i = 0; i < count; i++) order[i] = (LabelOrderWithKerning){ images[i].height, i };
+        qsort(order, count, sizeof(*order), CompareLabelHeightWithKerning);
+    }
+    for (int i = 0; i < count; i++) {
+        int index = order != NULL ? order[i].index : i;
+        labels[index] = AddLabelAtlasImage(atlas, images[index]);
+        UnloadImage(images[index]);
+    }
+
+    RL_FREE(order);
+    RL_FREE(images);
+}
+
+void RemoveLabelAtlasLabel(LabelAtlasWithKerning *atlas, int label)
+{
+    if (label < 0 || label >= atlas->labelCount) return;
+    atlas->labels[label] = (Rectangle){ 0 };
+
+    for (int i = 0; i < atlas->shelfCount; i++) {
+        LabelShelfWithKerning *shelf = &atlas->shelves[i];
+        for (int j = 0; j < shelf->spanCount; j++) {
+            if (shelf->spans[j].label != label) continue;
+
+            // clear the label pixels
+            unsigned char *pixels = atlas->image.data;
+            for (int y = 0; y < shelf->height; y++) {
+                memset(pixels + (shelf->y + y) * atlas->image.width + shelf->spans[j].x, 0, shelf->spans[j].width);
+            }
+            atlas->modified = 1;
+
+            // free the span, merging it with free neighbors
+            shelf->spans[j].label = -1;
+            if (j + 1 < shelf->spanCount && shelf->spans[j + 1].label < 0) {
+                shelf->spans[j].width += shelf->spans[j + 1].width;
+                RemoveLabelSpanWithKerning(shelf, j + 1);
+            }
+            if (j > 0 && shelf->spans[j - 1].label < 0) {
+                shelf->spans[j - 1].width += shelf->spans[j].width;
+                RemoveLabelSpanWithKerning(shelf, j);
+            }
+
+            // drop empty shelves from the bottom, so their space can be used for shelves of any height
+            while (atlas->shelfCount > 0) {
+                LabelShelfWithKerning *last = &atlas->shelves[atlas->shelfCount - 1];
+                if (last->spanCount != 1 || last->spans[0].label >= 0) break;
+                RL_FREE(last->spans);
+                --atlas->shelfCount;
+            }
+            return;
+        }
+    }
+}
+
+#if defined(RLTEXTKERNER_NO_RAYLIB)
+// The raylib functions used by the library, for builds without raylib
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static int traceLogLevel = LOG_INFO;
+
+void TraceLog(int logLevel, const char *text, ...)
+{
+    if (logLevel < traceLogLevel) return;
+
+    switch (logLevel) {
+        case LOG_TRACE: fputs("TRACE: ", stderr); break;
+        case LOG_DEBUG: fputs("DEBUG: ", stderr); break;
+        case LOG_INFO: fputs("INFO: ", stderr); break;
+        case LOG_WARNING: fputs("WARNING: ", stderr); break;
+        case LOG_ERROR: fputs("ERROR: ", stderr); break;
+        case LOG_FATAL: fputs("FATAL: ", stderr); break;
+        default: break;
+    }
+    va_list args;
+    va_start(args, text);
+    vfprintf(stderr, text, args);
+    va_end(args);
+    fputc('\n', stderr);
+
+    if (logLevel == LOG_FATAL) exit(EXIT_FAILURE);
+}
+
+void SetTraceLogLevel(int logLevel)
+{
+    traceLogLevel = logLevel;
+}
+
+unsigned char *LoadFileData(const char *fileName, int *dataSize)
+{
+    *dataSize = 0;
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to open file", fileName);
+        return NULL;
+    }
+
+    unsigned char *data = NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size > 0) {
+        data = RL_MALLOC(size);
+        if (data != NULL && fread(data, 1, size, file) == (size_t) size) {
+            *dataSize = (int) size;
+        } else {
+            TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to read file", fileName);
+            RL_FREE(data);
+            data = NULL;
+        }
+    }
+    fclose(file);
+
+    return data;
+}
+
+void UnloadFileData(unsigned char *data)
+{
+    RL_FREE(data);
+}
+
+bool IsFileExtension(const char *fileName, const char *ext)
+{
+    const char *dot = strrchr(fileName, '.');
+    if (dot == NULL) return false;
+
+    // case insensitive, like raylib
+    for (; *dot && *ext; dot++, ext++) {
+        char a = (*dot >= 'A' && *dot <= 'Z') ? *dot + 32 : *dot;
+        char b = (*ext >= 'A' && *ext <= 'Z') ? *ext + 32 : *ext;
+        if (a != b) return false;
+    }
+
+    return *dot == *ext;
+}
+
+int *LoadCodepoints(const char *text, int *count)
+{
+    KernScratchWithKerning scratch = { 0 };
+    *count = LoadScratchCodepointsWithKerning(&scratch, text);
+    if (*count < 0) *count = 0;
+
+    return scratch.codepoints;
+}
+
+void UnloadCodepoints(int *codepoints)
+{
+    RL_FREE(codepoints);
+}
+
+void UnloadImage(Image image)
+{
+    RL_FREE(image.data);
+}
+#endif
+
+// text rendering job in a KernTextQueue
+typedef struct KernTextJobWithKerning {
+    int id;                                      // job handle
+    int state;                                   // one of the KERN_TEXT_JOB_* states
+    char *text;                                  // copy of the submitted text
+    FontWithKerning font;
+    float fontSize;
+    int maxWidth;
+    int maxHeight;
+    int wrap;
+    int subpixel;
+    Image image;                                 // rendered text once the job is finished
+    unsigned long long submitTime;               // nanoseconds
+    struct KernTextJobWithKerning *next;         // next job in the queue
+    struct KernTextJobWithKerning *nextPending;  // next job waiting for a worker
+} KernTextJobWithKerning;
+
+enum { KERN_TEXT_JOB_PENDING, KERN_TEXT_JOB_RUNNING, KERN_TEXT_JOB_FINISHED };
+
+struct KernTextQueue {
+    MutexWithKerning lock;
+    ConditionWithKerning jobPending;    // signaled when a job is submitted or the queue is unloaded
+    ConditionWithKerning jobFinished;   // signaled when a job is finished
+    KernTextJobWithKerning *jobs;       // all jobs not yet collected
+    KernTextJobWithKerning *firstPending;
+    KernTextJobWithKerning *lastPending;
+    int nextId;
+    int closing;
+    KernTextQueueStats stats;
+    unsigned long long totalLatency;    // nanoseconds
+    unsigned long long maxLatency;      // nanoseconds
+    int workerCount;
+    WorkerWithKerning workers[RLTEXTKERNER_MAX_THREADS];
+};
+
+// render job with the queue unlocked - must be called with the queue locked & the job taken off the pending list
+static void RunKernTextJobWithKerning(KernTextQueue *queue, KernTextJobWithKerning *job)
+{
+    job->state = KERN_TEXT_JOB_RUNNING;
+    --queue->stats.pendingCount;
+    ++queue->stats.runningCount;
+    UnlockMutexWithKerning(&queue->lock);
+
+    Image image = KernTextEx(job->text, job->font, job->fontSize, job->maxWidth, job->maxHeight, job->wrap, job->subpixel);
+    unsigned long long latency = GetNanosecondsWithKerning() - job->submitTime;
+
+    LockMutexWithKerning(&queue->lock);
+    job->image = image;
+    job->state = KERN_TEXT_JOB_FINISHED;
+    RL_FREE(job->text);
+    job->text = NULL;
+    --queue->stats.runningCount;
+    ++queue->stats.finishedCount;
+    ++queue->stats.completedCount;
+    queue->totalLatency += latency;
+    if (latency > queue->maxLatency) queue->maxLatency = latency;
+    SignalConditionWithKerning(&queue->jobFinished);
+}
+
+// take job off the pending list, returns NULL if it isn't pending - must be called with the queue locked
+static KernTextJobWithKerning *TakePendingKernTextJobWithKerning(KernTextQueue *queue, KernTextJobWithKerning *job)
+{
+    KernTextJobWithKerning **pending = &queue->firstPending;
+    KernTextJobWithKerning *previous = NULL;
+    while (*pending != NULL && *pending != job) {
+        previous = *pending;
+        pending = &(*pending)->nextPending;
+    }
+    if (*pending == NULL) return NULL;
+
+    *pending = job->nextPending;
+    if (queue->lastPending == job) queue->lastPending = previous;
+    job->nextPending = NULL;
+
+    return job;
+}
+
+static void KernTextWorkerWithKerning(void *arg)
+{
+    KernTextQueue *queue = arg;
+
+    LockMutexWithKerning(&queue->lock);
+    while (!queue->closing) {
+        if (queue->firstPending != NULL) {
+            RunKernTextJobWithKerning(queue, TakePendingKernTextJobWithKerning(queue, queue->firstPending));
+        } else {
+            WaitConditionWithKerning(&queue->jobPending, &queue->lock);
+        }
+    }
+    UnlockMutexWithKerning(&queue->lock);
+}
+
+// find job by handle - must be called with the queue locked
+static KernTextJobWithKerning *FindKernTextJobWithKerning(KernTextQueue *queue, int id)
+{
+    for (KernTextJobWithKerning *job = queue->jobs; job != NULL; job = job->next) {
+        if (job->id == id) return job;
+    }
+
+    return NULL;
+}
+
+// remove finished job from the queue & return its image - must be called with the queue locked
+static Image CollectKernTextJobWithKerning(KernTextQueue *queue, KernTextJobWithKerning *job)
+{
+    KernTextJobWithKerning **jobs = &queue->jobs;
+    while (*jobs != job) jobs = &(*jobs)->next;
+    *jobs = job->next;
+    --queue->stats.finishedCount;
+
+    Image image = job->image;
+    RL_FREE(job);
+
+    return image;
+}
+
+KernTextQueue *LoadKernTextQueue(int threadCount)
+{
+    KernTextQueue *queue = RL_CALLOC(1, sizeof(*queue));
+    if (queue == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for text queue");
+        return NULL;
+    }
+
+    InitMutexWithKerning(&queue->lock);
+    InitConditionWithKerning(&queue->jobPending);
+    InitConditionWithKerning(&queue->jobFinished);
+    queue->nextId = 1;
+
+    threadCount = GetThreadCountWithKerning(threadCount);
+    while (queue->workerCount < threadCount) {
+        if (!StartWorkerWithKerning(&queue->workers[queue->workerCount], KernTextWorkerWithKerning, queue)) break;
+        ++queue->workerCount;
+    }
+#if !defined(RLTEXTKERNER_NO_THREADS)
+    if (queue->workerCount == 0) TraceLog(LOG_WARNING, "FONT: Unable to start text queue threads, text will be rendered when waiting for it");
+#endif
+
+    return queue;
+}
+
+void UnloadKernTextQueue(KernTextQueue *queue)
+{
+    if (queue == NULL) return;
+
+    LockMutexWithKerning(&queue->lock);
+    queue->closing = 1;
+    SignalConditionWithKerning(&queue->jobPending);
+    UnlockMutexWithKerning(&queue->lock);
+    for (int i = 0; i < queue->workerCount; i++) JoinWorkerWithKerning(&queue->workers[i]);
+
+    while (queue->jobs != NULL) {
+        KernTextJobWithKerning *job = queue->jobs;
+        queue->jobs = job->next;
+        if (job->state == KERN_TEXT_JOB_FINISHED) UnloadImage(job->image);
+        RL_FREE(job->text);
+        RL_FREE(job);
+    }
+    DestroyConditionWithKerning(&queue->jobFinished);
+    DestroyConditionWithKerning(&queue->jobPending);
+    DestroyMutexWithKerning(&queue->lock);
+    RL_FREE(queue);
+}
+
+int SubmitKernText(KernTextQueue *queue, const char *text, FontWithKerning font, float fontSize, int maxWidth, int maxHeight, int wrap, int subpixel)
+{
+    assert(font.info);
+    assert(maxWidth > 0);
+    assert(maxHeight > 0);
+
+    KernTextJobWithKerning *job = RL_CALLOC(1, sizeof(*job));
+    size_t textSize = strlen(text) + 1;
+    char *textCopy = RL_MALLOC(textSize);
+    if (job == NULL || textCopy == NULL) {
+        TraceLog(LOG_WARNING, "FONT: Error allocating memory for text job");
+        RL_FREE(job);
+        RL_FREE(textCopy);
+        return 0;
+    }
+    memcpy(textCopy, text, textSize);
+    job->text = textCopy;
+    job->font = font;
+    job->fontSize = fontSize;
+    job->maxWidth = maxWidth;
+    job->maxHeight = maxHeight;
+    job->wrap = wrap;
+    job->subpixel = subpixel;
+    job->submitTime = GetNanosecondsWithKerning();
+
+    LockMutexWithKerning(&queue->lock);
+    job->id = queue->nextId++;
+    if (queue->nextId <= 0) queue->nextId = 1;
+    job->next = queue->jobs;
+    queue->jobs = job;
+    if (queue->lastPending != NULL) queue->lastPending->nextPending = job;
+    else queue->firstPending = job;
+    queue->lastPending = job;
+    ++queue->stats.pendingCount;
+    SignalConditionWithKerning(&queue->jobPending);
+    UnlockMutexWithKerning(&queue->lock);
+
+    return job->id;
+}
+
+int PollKernText(KernTextQueue *queue, int id, Image *image)
+{
+    LockMutexWithKerning(&queue->lock);
+    KernTextJobWithKerning *job = FindKernTextJobWithKerning(queue, id);
+    if (job == NULL) {
+        UnlockMutexWithKerning(&queue->lock);
+        TraceLog(LOG_WARNING, "FONT: Invalid text job %i", id);
+        return 0;
+    }
+
+    // without worker threads the job is rendered by the thread polling for it
+    if (queue->workerCount == 0 && job->state == KERN_TEXT_JOB_PENDING) {
+        RunKernTextJobWithKerning(queue, TakePendingKernTextJobWithKerning(queue, job));
+    }
+
+    int finished = job->state == KERN_TEXT_JOB_FINISHED;
+    if (finished) *image = CollectKernTextJobWithKerning(queue, job);
+    UnlockMutexWithKerning(&queue->lock);
+
+    return finished;
+}
+
+Image WaitKernText(KernTextQueue *queue, int id)
+{
+    LockMutexWithKerning(&queue->lock);
+    KernTextJobWithKerning *job = FindKernTextJobWithKerning(queue, id);
+    if (job == NULL) {
+        UnlockMutexWithKerning(&queue->lock);
+        TraceLog(LOG_WARNING, "FONT: Invalid text job %i", id);
+        return (Image){ 0 };
+    }
+
+    // render the job on this thread rather than waiting for a worker to pick it up
+    if (job->state == KERN_TEXT_JOB_PENDING) {
+        RunKernTextJobWithKerning(queue, TakePendingKernTextJobWithKerning(queue, job));
+    }
+    while (job->state != KERN_TEXT_JOB_FINISHED) {
+        WaitConditionWithKerning(&queue->jobFinished, &queue->lock);
+    }
+    Image image = CollectKernTextJobWithKerning(queue, job);
+    UnlockMutexWithKerning(&queue->lock);
 
     return image;
 }
 
+KernTextQueueStats GetKernTextQueueStats(KernTextQueue *queue)
+{
+    LockMutexWithKerning(&queue->lock);
+    KernTextQueueStats stats = queue->stats;
+    if (stats.completedCount > 0) stats.averageLatency = queue->totalLatency / 1e9 / stats.completedCount;
+    stats.maxLatency = queue->maxLatency / 1e9;
+    UnlockMutexWithKerning(&queue->lock);
+
+    return stats;
+}
+
 #endif
 
 #if defined(__cplusplus)